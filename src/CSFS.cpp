@@ -1,4 +1,6 @@
 #include "CSFS.h"
+#include "Cut.h"
+#include "PatfileReader.h"
 #include <iomanip>
 #include <iostream>
 #include <cassert>
@@ -89,6 +91,39 @@ double CSFS::getObjectiveValue(const std::size_t numGrpOneWithPattern,
 }
 
 
+//------------------------------------------------------------------------------
+// Returns the pattern with the highest objective value in PATTERN_FILE (a
+// logfile of an earlier run on the same data), or an empty vector if it holds
+// none. The states are those of the data file, so the data must not have been
+// presolved.
+//------------------------------------------------------------------------------
+std::vector<std::size_t> CSFS::getBestPatternInPatfile(const CSFS_Data *data)
+{
+  std::vector<std::size_t> bestPattern;
+  double bestObjValue = 0;
+
+  PatternReader reader(*data);
+  Cut pattern(data->numStates);
+  while (reader.nextPat(&pattern))
+  {
+    const std::vector<std::size_t> states = pattern.getTrueElements();
+    if (states.size() != data->setSize)
+      continue;
+
+    const double objValue = getObjectiveValue(data->exprs.countCarryingAll(states, data->grpOneStart, data->grpOneEnd),
+                                              data->exprs.countCarryingAll(states, data->grpTwoStart, data->grpTwoEnd),
+                                              data);
+    if (bestPattern.empty() || objValue > bestObjValue)
+    {
+      bestPattern = states;
+      bestObjValue = objValue;
+    }
+  }
+
+  return bestPattern;
+}
+
+
 //------------------------------------------------------------------------------
 // Returns a string of info to be printed at the end of each iteration
 //------------------------------------------------------------------------------
@@ -126,31 +161,9 @@ void CSFS::printSolution(const std::vector<std::size_t> &solution,
   // *
   // * Count the number of individuals in each group with the pattern
   // *
-  std::size_t numGrpOneWithPattern = data->numGrpOne;
-  for (std::size_t j = data->grpOneStart; j <= data->grpOneEnd; ++j)
-  {
-    for (std::size_t i = 0; i < data->setSize; ++i)
-    {
-      if (data->exprs[solution[i]][j] != 1)
-      {
-        --numGrpOneWithPattern;
-        break;
-      }
-    }
-  }
-
-  std::size_t numGrpTwoWithPattern = data->numGrpTwo;
-  for (std::size_t j = data->grpTwoStart; j <= data->grpTwoEnd; ++j)
-  {
-    for (std::size_t i = 0; i < data->setSize; ++i)
-    {
-      if (data->exprs[solution[i]][j] != 1)
-      {
-        --numGrpTwoWithPattern;
-        break;
-      }
-    }
-  }
+  const std::vector<std::size_t> pattern(std::begin(solution), std::begin(solution) + data->setSize);
+  const std::size_t numGrpOneWithPattern = data->exprs.countCarryingAll(pattern, data->grpOneStart, data->grpOneEnd);
+  const std::size_t numGrpTwoWithPattern = data->exprs.countCarryingAll(pattern, data->grpTwoStart, data->grpTwoEnd);
 
   // *
   // * Calculate ratios and objective value
@@ -187,7 +200,8 @@ void CSFS::printSolution(const std::vector<std::size_t> &solution,
 
   for (std::size_t i = 0; i < data->setSize; ++i)
   {
-    std::size_t exprsNumber = solution[i] / data->numBins; // number of bins based on config file
+    const std::size_t state = data->originalState[solution[i]]; // state in the data file
+    std::size_t exprsNumber = state / data->numBins; // number of bins based on config file
 
     if (data->exprsInfo[exprsNumber + 1][data->idColNum] == "dummy")
     {
@@ -199,7 +213,7 @@ void CSFS::printSolution(const std::vector<std::size_t> &solution,
       logfileOutput << data->exprsInfo[exprsNumber + 1][data->idColNum] << "\t";
 
       // Print out associated bounds
-      const std::size_t exprsState = solution[i] % data->numBins; // number of bins based on config file
+      const std::size_t exprsState = state % data->numBins; // number of bins based on config file
 
       // Check if state is for HIGH
       if ((data->USE_HIGH) && (exprsState == highIndex))
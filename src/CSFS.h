@@ -11,6 +11,7 @@ namespace CSFS
   bool getNextEnumerationCoords(std::vector<std::size_t> *,
                                 const std::size_t,
                                 const std::vector<std::size_t> &);
+  std::vector<std::size_t> getBestPatternInPatfile(const CSFS_Data *);
   double getObjectiveValue(const std::size_t,
                            const std::size_t,
                            const CSFS_Data *);
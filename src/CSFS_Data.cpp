@@ -1,5 +1,92 @@
 #include "CSFS_Data.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
 #include <limits>
+#include <thread>
+
+namespace
+{
+	// Start of a binary data file written by CSFS_Data::writeBinary(). Bump the
+	// version whenever the layout of the file changes.
+	const char BINARY_MAGIC[8] = {'C', 'S', 'F', 'S', 'B', 'I', 'N', '\0'};
+	const std::uint32_t BINARY_FORMAT_VERSION = 1;
+	const std::uint32_t BINARY_BYTE_ORDER = 0x01020304;
+
+	// Smallest share of the data file worth giving its own loader thread
+	const std::size_t MIN_BYTES_PER_LOADER_THREAD = std::size_t(4) << 20;
+
+	inline bool isSpace(const char c)
+	{
+		return c == ' ' || (c >= '\t' && c <= '\r');
+	}
+
+	// Returns a pointer to the newline ending the line that starts at line, or
+	// end if the line is not ended before end
+	inline const char *lineEndOf(const char *line, const char *end)
+	{
+		const char *newline = static_cast<const char *>(memchr(line, '\n', end - line));
+		return newline ? newline : end;
+	}
+
+	// Finds the next whitespace separated token in [*pos, end) and moves *pos
+	// past it. Returns false if there is none.
+	inline bool nextToken(const char **pos, const char *end, const char **tokenBegin, const char **tokenEnd)
+	{
+		const char *p = *pos;
+		while (p != end && isSpace(*p))
+			++p;
+		if (p == end)
+		{
+			*pos = end;
+			return false;
+		}
+
+		*tokenBegin = p;
+		while (p != end && !isSpace(*p))
+			++p;
+		*tokenEnd = p;
+		*pos = p;
+		return true;
+	}
+
+	// Calls f(t) for t in [0, numThreads), each on its own thread, and rethrows
+	// the first exception thrown by any of them
+	template <typename F>
+	void runOnThreads(const std::size_t numThreads, F f)
+	{
+		if (numThreads == 1)
+		{
+			f(0);
+			return;
+		}
+
+		std::vector<std::exception_ptr> errors(numThreads);
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < numThreads; ++t)
+		{
+			threads.emplace_back([&f, &errors, t]() {
+				try
+				{
+					f(t);
+				}
+				catch (...)
+				{
+					errors[t] = std::current_exception();
+				}
+			});
+		}
+
+		for (auto it = std::begin(threads); it != std::end(threads); ++it)
+			it->join();
+		for (auto it = std::begin(errors); it != std::end(errors); ++it)
+		{
+			if (*it)
+				std::rethrow_exception(*it);
+		}
+	}
+}
 
 CSFS_Data::CSFS_Data(const std::string &configFile) :	timer(true),
 																										startTime(timer.current_time()),
@@ -19,6 +106,16 @@ CSFS_Data::CSFS_Data(const std::string &configFile) :	timer(true),
                           													CPLEX_SEED(parser.getSizeT("CPLEX_SEED")),
                           													USE_LOWER_CUTOFF(parser.getBool("USE_LOWER_CUTOFF")),
                           													USE_SPARSE_CONTRAINTS(parser.getBool("USE_SPARSE_CONTRAINTS")),
+                          													MAX_QUEUED_PROBLEMS(parser.contains("MAX_QUEUED_PROBLEMS") ? parser.getSizeT("MAX_QUEUED_PROBLEMS") : std::numeric_limits<std::size_t>::max()),
+                          													USE_NATIVE_SPARSE_SOLVER(parser.contains("SPARSE_SOLVER") && parser.getString("SPARSE_SOLVER") == "NATIVE"),
+                          													WORKER_THREADS(parser.contains("WORKER_THREADS") ? parser.getSizeT("WORKER_THREADS") : 1),
+                          													SPLIT_MIN_CUT_SIZE(parser.contains("SPLIT_MIN_CUT_SIZE") ? parser.getSizeT("SPLIT_MIN_CUT_SIZE") : 32),
+                          													PRESOLVE(!parser.contains("PRESOLVE") || parser.getBool("PRESOLVE")),
+                          													ENUMERATE(parser.contains("ENUMERATE") && parser.getBool("ENUMERATE")),
+                          													HEURISTIC_STARTS(parser.contains("HEURISTIC_STARTS") ? parser.getSizeT("HEURISTIC_STARTS") : 64),
+                          													SHARE_LOWER_BOUND(parser.contains("SHARE_LOWER_BOUND") && parser.getBool("SHARE_LOWER_BOUND")),
+                          													CHECKPOINT_INTERVAL(parser.contains("CHECKPOINT_INTERVAL") ? parser.getDouble("CHECKPOINT_INTERVAL") : 0),
+                          													WRITE_CUTS_FILE(parser.contains("WRITE_CUTS_FILE") && parser.getBool("WRITE_CUTS_FILE")),
 																										inputFilename(parser.getString("DATA_FILE")),
 																										numActualExprs(parser.getSizeT("NUM_EXPRS")),
 																										setSize(parser.getSizeT("PATTERN_SIZE") >= 1 && parser.getSizeT("PATTERN_SIZE") <= 2 * numActualExprs ? parser.getSizeT("PATTERN_SIZE") : 1),
@@ -27,6 +124,12 @@ CSFS_Data::CSFS_Data(const std::string &configFile) :	timer(true),
 																										numHeadRows(parser.getSizeT("NUM_HEAD_ROWS")),
 																										numHeadCols(parser.getSizeT("NUM_HEAD_COLS")),
 																										logfileName(determineLogfileName()),
+																										checkpointFileName(parser.contains("CHECKPOINT_FILE") ? parser.getString("CHECKPOINT_FILE")
+																										                                                      : logfileName.substr(0, logfileName.size() - 4) + ".checkpoint"),
+																										inputPatfileName(parser.contains("PATTERN_FILE") ? parser.getString("PATTERN_FILE") : ""),
+																										inputCutfileName(parser.contains("CUTS_FILE") ? parser.getString("CUTS_FILE") : ""),
+																										outputCutfileName(determineOutputCutfileName()),
+																										telemetryFileName(parser.contains("TELEMETRY_FILE") ? parser.getString("TELEMETRY_FILE") : ""),
 														           							numBins(parser.getSizeT("NUM_BINS")),
 																										numStates(numBins * numActualExprs),
 																										numIndiv(numCase + numCtrl),
@@ -47,13 +150,8 @@ CSFS_Data::CSFS_Data(const std::string &configFile) :	timer(true),
 																										NORM_VALUE(parser.getDouble("NORM_VALUE")),
 																										LOW_VALUE(parser.getDouble("LOW_VALUE")),
                           													NOT_LOW_VALUE(parser.getDouble("NOT_LOW_VALUE")),
-																										NOT_HIGH_VALUE(parser.getDouble("NOT_HIGH_VALUE")) {
-	// Set up the expression matrix
-	std::vector<bool> expressionRow(numIndiv, 0);
-	for (std::size_t i = 0; i < numStates; ++i) {
-		exprs.push_back(expressionRow);
-	}
-
+																										NOT_HIGH_VALUE(parser.getDouble("NOT_HIGH_VALUE")),
+																										exprs(numStates, numIndiv) {
 	// Set up the expression info matrix
 	std::vector<std::string> exprInfoRow(numHeadCols, "");
 	for (std::size_t i = 0; i < numActualExprs + 1; ++i) {
@@ -63,10 +161,94 @@ CSFS_Data::CSFS_Data(const std::string &configFile) :	timer(true),
 	std::vector<double> boundariesRow(2, 0.0);
 	for (size_t i = 0; i < numStates; ++i) {
 		boundaries.push_back(boundariesRow);
+		originalState.push_back(i);
 	}
 
-	// Read the input data
-	readInput(); 
+	// Read the input data (on rank 0 only, when running under MPI)
+	loadInput();
+}
+
+//------------------------------------------------------------------------------
+// Creates a copy of the given data that only has the given states, in the
+// given order. Individuals and parameters are unchanged, and originalState
+// still maps each state back to the data file.
+//------------------------------------------------------------------------------
+CSFS_Data::CSFS_Data(const CSFS_Data &other, const std::vector<std::size_t> &keptStates) :
+	timer(other.timer),
+	startTime(other.startTime),
+	parser(other.parser),
+	configFilename(other.configFilename),
+	STARTING_LOWER_BOUND(other.STARTING_LOWER_BOUND),
+	STARTING_UPPER_BOUND(other.STARTING_UPPER_BOUND),
+	USE_SOLUTION_POOL_THRESHOLD(other.USE_SOLUTION_POOL_THRESHOLD),
+	SOLUTION_POOL_THRESHOLD(other.SOLUTION_POOL_THRESHOLD),
+	RISK(other.RISK),
+	QUIET(other.QUIET),
+	VERBOSE(other.VERBOSE),
+	PRINT_CPLEX_OUTPUT(other.PRINT_CPLEX_OUTPUT),
+	TOL(other.TOL),
+	ID_PREFIX(other.ID_PREFIX),
+	MISSING_SYMBOL(other.MISSING_SYMBOL),
+	CPLEX_SEED(other.CPLEX_SEED),
+	USE_LOWER_CUTOFF(other.USE_LOWER_CUTOFF),
+	USE_SPARSE_CONTRAINTS(other.USE_SPARSE_CONTRAINTS),
+	MAX_QUEUED_PROBLEMS(other.MAX_QUEUED_PROBLEMS),
+	USE_NATIVE_SPARSE_SOLVER(other.USE_NATIVE_SPARSE_SOLVER),
+	WORKER_THREADS(other.WORKER_THREADS),
+	SPLIT_MIN_CUT_SIZE(other.SPLIT_MIN_CUT_SIZE),
+	PRESOLVE(other.PRESOLVE),
+	ENUMERATE(other.ENUMERATE),
+	HEURISTIC_STARTS(other.HEURISTIC_STARTS),
+	SHARE_LOWER_BOUND(other.SHARE_LOWER_BOUND),
+	CHECKPOINT_INTERVAL(other.CHECKPOINT_INTERVAL),
+	WRITE_CUTS_FILE(other.WRITE_CUTS_FILE),
+	inputFilename(other.inputFilename),
+	numActualExprs(other.numActualExprs),
+	setSize(other.setSize),
+	numCase(other.numCase),
+	numCtrl(other.numCtrl),
+	numHeadRows(other.numHeadRows),
+	numHeadCols(other.numHeadCols),
+	logfileName(other.logfileName),
+	checkpointFileName(other.checkpointFileName),
+	inputPatfileName(other.inputPatfileName),
+	inputCutfileName(other.inputCutfileName),
+	outputCutfileName(other.outputCutfileName),
+	telemetryFileName(other.telemetryFileName),
+	numBins(other.numBins),
+	numStates(keptStates.size()),
+	numIndiv(other.numIndiv),
+	numGrpOne(other.numGrpOne),
+	numGrpTwo(other.numGrpTwo),
+	grpOneStart(other.grpOneStart),
+	grpOneEnd(other.grpOneEnd),
+	grpTwoStart(other.grpTwoStart),
+	grpTwoEnd(other.grpTwoEnd),
+	idColNum(other.idColNum),
+	USE_HIGH(other.USE_HIGH),
+	USE_NORM(other.USE_NORM),
+	USE_LOW(other.USE_LOW),
+	USE_NOT_LOW(other.USE_NOT_LOW),
+	USE_NOT_HIGH(other.USE_NOT_HIGH),
+	SET_NA_TUE(other.SET_NA_TUE),
+	HIGH_VALUE(other.HIGH_VALUE),
+	NORM_VALUE(other.NORM_VALUE),
+	LOW_VALUE(other.LOW_VALUE),
+	NOT_LOW_VALUE(other.NOT_LOW_VALUE),
+	NOT_HIGH_VALUE(other.NOT_HIGH_VALUE),
+	exprsInfo(other.exprsInfo),
+	exprs(keptStates.size(), other.numIndiv)
+{
+	const std::size_t words = exprs.stateRowWords();
+	for (std::size_t k = 0; k < keptStates.size(); ++k)
+	{
+		const std::uint64_t *row = other.exprs.stateRow(keptStates[k]);
+		std::copy(row, row + words, exprs.mutableStateRow(k));
+		boundaries.push_back(other.boundaries[keptStates[k]]);
+		originalState.push_back(other.originalState[keptStates[k]]);
+	}
+	if (numIndiv > 0)
+		exprs.updateIndivRows(0, numIndiv - 1);
 }
 
 //------------------------------------------------------------------------------
@@ -101,6 +283,21 @@ void CSFS_Data::checkParameters() const
 	if (QUIET && VERBOSE)
 		throw std::runtime_error("QUIET and VERBOSE cannot both be true.");
 
+	if (parser.contains("SPARSE_SOLVER") && parser.getString("SPARSE_SOLVER") != "CPLEX" && parser.getString("SPARSE_SOLVER") != "NATIVE")
+		throw std::runtime_error("SPARSE_SOLVER must be CPLEX or NATIVE.");
+
+	if (WORKER_THREADS < 1)
+		throw std::runtime_error("WORKER_THREADS must be at least 1.");
+
+	if (ENUMERATE && setSize > 3)
+		throw std::runtime_error("ENUMERATE can only be used with a PATTERN_SIZE of 3 or less.");
+
+	if (!inputCutfileName.empty() && inputPatfileName.empty() && !USE_SOLUTION_POOL_THRESHOLD)
+		throw std::runtime_error("CUTS_FILE must be given with the PATTERN_FILE of the run that wrote it, unless USE_SOLUTION_POOL_THRESHOLD is true.");
+
+	if (CHECKPOINT_INTERVAL < 0)
+		throw std::runtime_error("CHECKPOINT_INTERVAL must not be negative.");
+
 	if (TOL <= 0)
 		throw std::runtime_error("TOL must be a positive number.");
 	if (TOL >= 1e-2)
@@ -225,7 +422,7 @@ double CSFS_Data::elapsed_cpu_time() const
 //------------------------------------------------------------------------------
 double CSFS_Data::elapsed_wall_time() const
 {
-	return timer.elapsed_cpu_time();
+	return timer.elapsed_wall_time();
 }
 
 //------------------------------------------------------------------------------
@@ -234,11 +431,11 @@ double CSFS_Data::elapsed_wall_time() const
 std::string CSFS_Data::exprMatrixString() const
 {
 	  std::ostringstream oss;
-  for (std::size_t i = 0; i < exprs.size(); ++i)
+  for (std::size_t i = 0; i < exprs.numStates(); ++i)
   {
-    oss << "State_" << i << ":";
-    for (std::size_t j = 0; j < exprs[i].size(); ++j)
-      oss << " " << static_cast<bool>(exprs[i][j]);
+    oss << "State_" << originalState[i] << ":";
+    for (std::size_t j = 0; j < exprs.numIndiv(); ++j)
+      oss << " " << exprs(i, j);
     oss << "\n";
   }
   return oss.str();
@@ -275,97 +472,404 @@ std::size_t CSFS_Data::getIdColNum() const
 	return std::size_t();
 }
 
+//------------------------------------------------------------------------------
+// Reads the input data on rank 0 and broadcasts it to the other ranks, so the
+// data file is only read once however many ranks there are. If MPI is not
+// running, the data file is simply read.
+//------------------------------------------------------------------------------
+void CSFS_Data::loadInput()
+{
+	int initialized;
+	MPI_Initialized(&initialized);
+	if (!initialized)
+	{
+		readInput();
+		return;
+	}
+
+	// *
+	// * The message starts with a flag saying whether rank 0 read the input,
+	// * followed by either the input or the reason it could not be read, so a
+	// * bad data file does not leave the other ranks waiting
+	// *
+	MessageBuffer buffer;
+	if (Parallel::getWorldRank() == 0)
+	{
+		try
+		{
+			readInput();
+			buffer.put(static_cast<char>(1));
+			packInput(&buffer);
+		}
+		catch (std::exception &e)
+		{
+			buffer.clear();
+			buffer.put(static_cast<char>(0));
+			buffer.putString(e.what());
+			buffer.broadcast(0);
+			throw;
+		}
+
+		buffer.broadcast(0);
+		return;
+	}
+
+	buffer.broadcast(0);
+	if (buffer.get<char>() == 0)
+		throw std::runtime_error("Rank 0 could not read the input data: " + buffer.getString());
+	unpackInput(&buffer);
+}
+
+
+//------------------------------------------------------------------------------
+// Packs the expression info and the state matrix read by readInput()
+//------------------------------------------------------------------------------
+void CSFS_Data::packInput(MessageBuffer *buffer) const
+{
+	buffer->putVersion();
+	for (std::size_t i = 0; i < exprsInfo.size(); ++i)
+	{
+		for (std::size_t j = 0; j < exprsInfo[i].size(); ++j)
+			buffer->putString(exprsInfo[i][j]);
+	}
+	buffer->putArray(exprs.stateRow(0), numStates * exprs.stateRowWords());
+}
+
+
+//------------------------------------------------------------------------------
+// Reads the expression info and the state matrix written by packInput()
+//------------------------------------------------------------------------------
+void CSFS_Data::unpackInput(MessageBuffer *buffer)
+{
+	buffer->checkVersion();
+	for (std::size_t i = 0; i < exprsInfo.size(); ++i)
+	{
+		for (std::size_t j = 0; j < exprsInfo[i].size(); ++j)
+			exprsInfo[i][j] = buffer->getString();
+	}
+
+	std::vector<std::uint64_t> rows(numStates * exprs.stateRowWords());
+	buffer->getArray(rows.data(), rows.size());
+	exprs.setStateRows(rows.data());
+}
+
+
+//------------------------------------------------------------------------------
+// Reads the data file, which is either a binary file written by writeBinary()
+// or a tab separated text file, into exprsInfo and the state matrix
+//------------------------------------------------------------------------------
 void CSFS_Data::readInput()
 {
-	FILE* input;
-	double exprs_data;
+	const MappedFile file(inputFilename);
+
+	if (file.size() >= sizeof(BINARY_MAGIC) && std::equal(BINARY_MAGIC, BINARY_MAGIC + sizeof(BINARY_MAGIC), file.begin()))
+		readBinary(file);
+	else
+		readText(file);
+}
+
+
+//------------------------------------------------------------------------------
+// Reads a binary data file written by writeBinary(). The binning parameters
+// and dimensions it was written with must match the config file. The state
+// rows are copied straight out of the mapped file.
+//------------------------------------------------------------------------------
+void CSFS_Data::readBinary(const MappedFile &file)
+{
+	const char *pos = file.begin() + sizeof(BINARY_MAGIC);
+	const std::size_t preambleSize = sizeof(BINARY_MAGIC) + 2 * sizeof(std::uint32_t) + sizeof(std::uint64_t);
+	if (file.size() < preambleSize)
+		throw std::runtime_error("Binary input file is truncated.");
+
+	std::uint32_t version;
+	std::uint32_t byteOrder;
+	std::uint64_t headerSize;
+	std::memcpy(&version, pos, sizeof(version));
+	std::memcpy(&byteOrder, pos + sizeof(version), sizeof(byteOrder));
+	std::memcpy(&headerSize, pos + sizeof(version) + sizeof(byteOrder), sizeof(headerSize));
+	pos = file.begin() + preambleSize;
+
+	if (version != BINARY_FORMAT_VERSION)
+		throw std::runtime_error("Binary input file has format version " + std::to_string(version)
+		                         + ", expected " + std::to_string(BINARY_FORMAT_VERSION) + ". Convert it again with csfs-convert.");
+	if (byteOrder != BINARY_BYTE_ORDER)
+		throw std::runtime_error("Binary input file was written on a machine with a different byte order.");
+	if (headerSize > file.size() - preambleSize)
+		throw std::runtime_error("Binary input file is truncated.");
+
+	MessageBuffer header;
+	header.assign(pos, headerSize);
+
+	// *
+	// * The file must have been converted with the same dimensions and binning
+	// * as this run uses
+	// *
+	auto check = [](const std::string &name, const std::string &fromFile, const std::string &fromConfig) {
+		if (fromFile != fromConfig)
+			throw std::runtime_error("DATA_FILE was converted with " + name + " " + fromFile
+			                         + ", but the config file gives " + fromConfig + ".");
+	};
+	check("NUM_EXPRS", std::to_string(header.get<std::uint64_t>()), std::to_string(numActualExprs));
+	check("NUM_CASES", std::to_string(header.get<std::uint64_t>()), std::to_string(numCase));
+	check("NUM_CTRLS", std::to_string(header.get<std::uint64_t>()), std::to_string(numCtrl));
+	check("NUM_HEAD_COLS", std::to_string(header.get<std::uint64_t>()), std::to_string(numHeadCols));
+	check("NUM_BINS", std::to_string(header.get<std::uint64_t>()), std::to_string(numBins));
+
+	const char *flagNames[] = {"USE_HIGH", "USE_NORM", "USE_LOW", "USE_NOT_LOW", "USE_NOT_HIGH", "SET_NA_TRUE"};
+	const bool flags[] = {USE_HIGH, USE_NORM, USE_LOW, USE_NOT_LOW, USE_NOT_HIGH, SET_NA_TUE};
+	for (std::size_t k = 0; k < 6; ++k)
+		check(flagNames[k], header.get<char>() ? "true" : "false", flags[k] ? "true" : "false");
+
+	const char *valueNames[] = {"HIGH_VALUE", "NORM_VALUE", "LOW_VALUE", "NOT_LOW_VALUE", "NOT_HIGH_VALUE"};
+	const bool used[] = {USE_HIGH, USE_NORM, USE_LOW, USE_NOT_LOW, USE_NOT_HIGH};
+	const double values[] = {HIGH_VALUE, NORM_VALUE, LOW_VALUE, NOT_LOW_VALUE, NOT_HIGH_VALUE};
+	for (std::size_t k = 0; k < 5; ++k)
+	{
+		const double value = header.get<double>();
+		if (used[k] && value != values[k])
+			check(valueNames[k], std::to_string(value), std::to_string(values[k]));
+	}
+
+	const std::string missingSymbol = header.getString();
+	if (SET_NA_TUE)
+		check("MISSING_SYMBOL", missingSymbol, MISSING_SYMBOL);
+
+	for (std::size_t i = 0; i < exprsInfo.size(); ++i)
+	{
+		for (std::size_t j = 0; j < exprsInfo[i].size(); ++j)
+			exprsInfo[i][j] = header.getString();
+	}
+
+	// *
+	// * The state rows start at the next multiple of 8 bytes
+	// *
+	const std::size_t matrixOffset = (preambleSize + headerSize + 7) & ~std::size_t(7);
+	const std::size_t matrixSize = numStates * exprs.stateRowWords() * sizeof(std::uint64_t);
+	if (file.size() < matrixOffset || file.size() - matrixOffset != matrixSize)
+		throw std::runtime_error("Binary input file is truncated.");
+
+	exprs.setStateRows(reinterpret_cast<const std::uint64_t *>(file.begin() + matrixOffset));
+}
 
-	if ((input = fopen(inputFilename.c_str(), "r")) == NULL)
-		throw std::runtime_error("Input file could not be opened.");
 
-	char strng[STRSIZE]; // temporary string storage
+//------------------------------------------------------------------------------
+// Reads a tab separated data file. The file is mapped into memory and its
+// expression rows are split into contiguous blocks of lines, each parsed on
+// its own thread straight into the state-major rows of the matrix (rows of
+// different expressions never share a word). The individual-major rows are
+// then rebuilt, again one block of individuals per thread.
+//------------------------------------------------------------------------------
+void CSFS_Data::readText(const MappedFile &file)
+{
+	const char *pos = file.begin();
+	const char *const end = file.end();
+	const char *tokenBegin;
+	const char *tokenEnd;
 
 	// read in header rows
 	// read in first header row and record expression header info
-	for (std::size_t j = 0; j < numHeadCols; ++j)
+	for (std::size_t j = 0; j < numHeadCols + numIndiv; ++j)
 	{
-		fscanf(input, "%s", strng);
-		exprsInfo[0][j] = strng;
+		if (!nextToken(&pos, end, &tokenBegin, &tokenEnd))
+			throw std::runtime_error("Input file is missing data");
+		if (j < numHeadCols)
+			exprsInfo[0][j].assign(tokenBegin, tokenEnd);
 	}
 
-	for (std::size_t j = numHeadCols; j < numHeadCols + numIndiv; ++j)
-		fscanf(input, "%s", strng); // disregard these
-
 	// read in the rest of the header rows and disregard
 	for (std::size_t i = 1; i < numHeadRows; ++i)
 	{
 		for (std::size_t j = 0; j < numHeadCols + numIndiv; ++j)
-			fscanf(input, "%s", strng);
+		{
+			if (!nextToken(&pos, end, &tokenBegin, &tokenEnd))
+				throw std::runtime_error("Input file is missing data");
+		}
 	}
 
-	std::size_t statePtr = 0; // point to current state
-	std::size_t highIndex = getHighIndex();
-	std::size_t normIndex = getNormIndex();
-	std::size_t lowIndex = getLowIndex();
-	std::size_t notHighIndex = getNotHighIndex();
-	std::size_t notLowIndex = getNotLowIndex();
-
-	// read in data
-	for (std::size_t i = 0; i < numActualExprs; ++i)
+	// *
+	// * Each bin in use, the value that sets it, and its offset from the
+	// * expression's first state
+	// *
+	std::vector<std::pair<double, std::size_t>> bins;
+	if (USE_HIGH)
+		bins.push_back(std::make_pair(HIGH_VALUE, getHighIndex()));
+	if (USE_NORM)
+		bins.push_back(std::make_pair(NORM_VALUE, getNormIndex()));
+	if (USE_LOW)
+		bins.push_back(std::make_pair(LOW_VALUE, getLowIndex()));
+	if (USE_NOT_LOW)
+		bins.push_back(std::make_pair(NOT_LOW_VALUE, getNotLowIndex()));
+	if (USE_NOT_HIGH)
+		bins.push_back(std::make_pair(NOT_HIGH_VALUE, getNotHighIndex()));
+
+	// *
+	// * Split the data rows into one block of whole lines per thread
+	// *
+	const std::size_t numThreads = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()),
+	                                                     1 + (end - pos) / MIN_BYTES_PER_LOADER_THREAD);
+	std::vector<const char *> blockStart(numThreads + 1, end);
+	blockStart[0] = pos;
+	for (std::size_t t = 1; t < numThreads; ++t)
 	{
-		for (std::size_t j = 0; j < numHeadCols; ++j)
+		const char *p = std::max(blockStart[t - 1], pos + (end - pos) / numThreads * t);
+		const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+		blockStart[t] = newline ? newline + 1 : end;
+	}
+
+	// *
+	// * Count the (non-blank) rows in each block to find the index of each
+	// * block's first expression
+	// *
+	std::vector<std::size_t> firstExpr(numThreads + 1, 0);
+	runOnThreads(numThreads, [&](const std::size_t t) {
+		const char *tokBegin;
+		const char *tokEnd;
+		std::size_t count = 0;
+		for (const char *line = blockStart[t]; line < blockStart[t + 1];)
 		{
-			fscanf(input, "%s", strng); // read in and record header columns
-			exprsInfo[i + 1][j] = strng;
+			const char *lineEnd = lineEndOf(line, blockStart[t + 1]);
+			const char *p = line;
+			if (nextToken(&p, lineEnd, &tokBegin, &tokEnd))
+				++count;
+			line = lineEnd + 1;
 		}
-	
-		for (std::size_t j = 0; j < numIndiv; ++j)
+		firstExpr[t + 1] = count;
+	});
+	for (std::size_t t = 0; t < numThreads; ++t)
+		firstExpr[t + 1] += firstExpr[t];
+	if (firstExpr[numThreads] < numActualExprs)
+		throw std::runtime_error("Input file is missing data");
+
+	// *
+	// * Parse the rows. Rows after the last expression are ignored.
+	// *
+	runOnThreads(numThreads, [&](const std::size_t t) {
+		const char *tokBegin;
+		const char *tokEnd;
+		std::size_t i = firstExpr[t];
+		for (const char *line = blockStart[t]; line < blockStart[t + 1] && i < numActualExprs;)
 		{
-			if (feof(input))
-				throw std::runtime_error("Input file is missing data");
+			const char *lineEnd = lineEndOf(line, blockStart[t + 1]);
+			const char *p = line;
+			line = lineEnd + 1;
 
-			fscanf(input, "%s", strng);
+			if (!nextToken(&p, lineEnd, &tokBegin, &tokEnd))
+				continue; // blank line
+			p = tokBegin;
 
-			// Check if string represents missing data
-			if ((MISSING_SYMBOL.compare(strng) == 0) && (SET_NA_TUE == true))
+			for (std::size_t j = 0; j < numHeadCols; ++j)
 			{
-				if (USE_HIGH)
-					exprs[statePtr + highIndex][j] = true;
-				if (USE_NORM)
-					exprs[statePtr + normIndex][j] = true;
-				if (USE_LOW)
-					exprs[statePtr + lowIndex][j] = true;
-				if (USE_NOT_LOW)
-					exprs[statePtr + notHighIndex][j] = true;
-				if (USE_NOT_HIGH)
-					exprs[statePtr + notLowIndex][j] = true;
+				if (!nextToken(&p, lineEnd, &tokBegin, &tokEnd))
+					throw std::runtime_error("Input file is missing data");
+				exprsInfo[i + 1][j].assign(tokBegin, tokEnd); // record header columns
 			}
-			else
+
+			const std::size_t statePtr = i * numBins; // point to current state
+			for (std::size_t j = 0; j < numIndiv; ++j)
 			{
-				exprs_data = atof(strng);
-					
-			  // Set bin values depending on percentile
-			  if (USE_HIGH && (exprs_data == HIGH_VALUE))
-				  exprs[statePtr + highIndex][j] = true;
-        
-			  if (USE_NORM && (exprs_data == NORM_VALUE))
-				  exprs[statePtr + normIndex][j] = true;
-        
-			  if (USE_LOW && (exprs_data == LOW_VALUE))
-				  exprs[statePtr + lowIndex][j] = true;
-        
-			  if (USE_NOT_LOW && (exprs_data == NOT_LOW_VALUE))
-			    exprs[statePtr + notLowIndex][j] = true;
-        
-			  if (USE_NOT_HIGH && (exprs_data == NOT_HIGH_VALUE))
-				  exprs[statePtr + notHighIndex][j] = true;
-		  }
-    }
-    
-		statePtr += numBins;
+				if (!nextToken(&p, lineEnd, &tokBegin, &tokEnd))
+					throw std::runtime_error("Input file is missing data");
+
+				const std::uint64_t bit = std::uint64_t(1) << (j & 63);
+
+				// Check if string represents missing data
+				if (SET_NA_TUE
+				    && static_cast<std::size_t>(tokEnd - tokBegin) == MISSING_SYMBOL.size()
+				    && std::equal(tokBegin, tokEnd, MISSING_SYMBOL.begin()))
+				{
+					for (auto it = std::begin(bins); it != std::end(bins); ++it)
+						exprs.mutableStateRow(statePtr + it->second)[j >> 6] |= bit;
+				}
+				else
+				{
+					// Set bin values depending on percentile
+					const double exprs_data = CSFSUtils::parseDouble(tokBegin, tokEnd);
+					for (auto it = std::begin(bins); it != std::end(bins); ++it)
+					{
+						if (exprs_data == it->first)
+							exprs.mutableStateRow(statePtr + it->second)[j >> 6] |= bit;
+					}
+				}
+			}
+
+			if (nextToken(&p, lineEnd, &tokBegin, &tokEnd))
+				throw std::runtime_error("Input file has more than NUM_HEAD_COLS + NUM_CASES + NUM_CTRLS columns on the row of expression "
+				                         + std::to_string(i));
+
+			++i;
+		}
+	});
+
+	// *
+	// * Fill in the individual-major copy of the matrix, one block of
+	// * individuals per thread
+	// *
+	const std::size_t numBlocks = std::min(numThreads, numIndiv);
+	runOnThreads(numBlocks, [&](const std::size_t t) {
+		const std::size_t first = numIndiv * t / numBlocks;
+		const std::size_t last = numIndiv * (t + 1) / numBlocks;
+		if (first < last)
+			exprs.updateIndivRows(first, last - 1);
+	});
+}
+
+//------------------------------------------------------------------------------
+// Writes the data in the binary format read by readBinary(), so later runs
+// with the same binning can skip parsing the text file. The file holds:
+//   the magic bytes, the format version, a byte order mark, the header size,
+//   the header (dimensions, binning parameters, expression info),
+//   zero padding to a multiple of 8 bytes, and
+//   the state-major rows of the state matrix.
+//------------------------------------------------------------------------------
+void CSFS_Data::writeBinary(const std::string &filename) const
+{
+	MessageBuffer header;
+	header.put(static_cast<std::uint64_t>(numActualExprs));
+	header.put(static_cast<std::uint64_t>(numCase));
+	header.put(static_cast<std::uint64_t>(numCtrl));
+	header.put(static_cast<std::uint64_t>(numHeadCols));
+	header.put(static_cast<std::uint64_t>(numBins));
+
+	const bool flags[] = {USE_HIGH, USE_NORM, USE_LOW, USE_NOT_LOW, USE_NOT_HIGH, SET_NA_TUE};
+	for (std::size_t k = 0; k < 6; ++k)
+		header.put(static_cast<char>(flags[k]));
+	header.put(HIGH_VALUE);
+	header.put(NORM_VALUE);
+	header.put(LOW_VALUE);
+	header.put(NOT_LOW_VALUE);
+	header.put(NOT_HIGH_VALUE);
+	header.putString(MISSING_SYMBOL);
+
+	for (std::size_t i = 0; i < exprsInfo.size(); ++i)
+	{
+		for (std::size_t j = 0; j < exprsInfo[i].size(); ++j)
+			header.putString(exprsInfo[i][j]);
 	}
+
+	const std::uint64_t headerSize = header.size();
+	const std::size_t preambleSize = sizeof(BINARY_MAGIC) + 2 * sizeof(std::uint32_t) + sizeof(std::uint64_t);
+	const std::size_t padding = ((preambleSize + headerSize + 7) & ~std::size_t(7)) - (preambleSize + headerSize);
+	const char zeros[8] = {0};
+
+	FILE *output = fopen(filename.c_str(), "wb");
+	if (output == NULL)
+		throw std::runtime_error("Could not open " + filename + " for writing.");
+
+	const std::size_t numWords = numStates * exprs.stateRowWords();
+	bool ok = fwrite(BINARY_MAGIC, sizeof(BINARY_MAGIC), 1, output) == 1
+	          && fwrite(&BINARY_FORMAT_VERSION, sizeof(BINARY_FORMAT_VERSION), 1, output) == 1
+	          && fwrite(&BINARY_BYTE_ORDER, sizeof(BINARY_BYTE_ORDER), 1, output) == 1
+	          && fwrite(&headerSize, sizeof(headerSize), 1, output) == 1
+	          && fwrite(header.data(), 1, headerSize, output) == headerSize
+	          && fwrite(zeros, 1, padding, output) == padding
+	          && (numWords == 0 || fwrite(exprs.stateRow(0), sizeof(std::uint64_t), numWords, output) == numWords);
+	ok = (fclose(output) == 0) && ok;
+
+	if (!ok)
+		throw std::runtime_error("Could not write " + filename + ".");
 }
 
+
 std::size_t CSFS_Data::getHighIndex() const
 {
 	return 0;
@@ -7,7 +7,9 @@
 #include "ConfigParser.h"
 #include "Timer.h"
 #include "CSFS_Utils.h"
-const std::size_t STRSIZE = 1024;
+#include "MappedFile.h"
+#include "MessageBuffer.h"
+#include "StateMatrix.h"
 
 class CSFS_Data
 {
@@ -18,7 +20,12 @@ private:
 	std::string determineLogfileName() const;
 	std::string determineOutputCutfileName() const;
 	std::size_t getIdColNum() const;
+	void loadInput();
+	void packInput(MessageBuffer *) const;
+	void readBinary(const MappedFile &);
 	void readInput();
+	void readText(const MappedFile &);
+	void unpackInput(MessageBuffer *);
 
 public:
 	const tm* startTime;
@@ -40,6 +47,16 @@ public:
   const std::size_t CPLEX_SEED;
   const bool USE_LOWER_CUTOFF;
   const bool USE_SPARSE_CONTRAINTS;	
+  const std::size_t MAX_QUEUED_PROBLEMS; // Optional; defaults to one per worker
+  const bool USE_NATIVE_SPARSE_SOLVER;   // Optional SPARSE_SOLVER; CPLEX (default) or NATIVE
+  const std::size_t WORKER_THREADS;      // Optional; sparse problems each worker solves at once, defaults to 1
+  const std::size_t SPLIT_MIN_CUT_SIZE;  // Optional; smallest cut split across idle workers, defaults to 32 (0 never splits)
+  const bool PRESOLVE;                   // Optional; drop states that cannot improve a pattern, defaults to true
+  const bool ENUMERATE;                  // Optional; score every pattern instead of cut and solve, defaults to false
+  const std::size_t HEURISTIC_STARTS;    // Optional; patterns the heuristic builds before the search, defaults to 64 (0 for none)
+  const bool SHARE_LOWER_BOUND;          // Optional; send improved lower bounds to busy workers, defaults to false
+  const double CHECKPOINT_INTERVAL;      // Optional; wall seconds between checkpoints, defaults to 0 (none)
+  const bool WRITE_CUTS_FILE;            // Optional; write each solved cut to outputCutfileName, defaults to false
 
 	const std::string inputFilename;
 	const std::size_t numActualExprs;
@@ -51,6 +68,11 @@ public:
 	const std::size_t numHeadCols;
 
 	const std::string logfileName;
+	const std::string checkpointFileName; // CHECKPOINT_FILE, or the logfile name ending in .checkpoint
+	const std::string inputPatfileName;   // PATTERN_FILE; empty if not given
+	const std::string inputCutfileName;   // CUTS_FILE; empty if not given
+	const std::string outputCutfileName;
+	const std::string telemetryFileName;  // TELEMETRY_FILE; empty if not given
 
 	const std::size_t numBins;
   const std::size_t numStates;
@@ -79,10 +101,12 @@ public:
 	const double NOT_HIGH_VALUE;
 
 	std::vector<std::vector<std::string>> exprsInfo;
-	std::vector<std::vector<bool>> exprs;
+	StateMatrix exprs; // exprs(i, j) is true if individual j carries state i
 	std::vector<std::vector<double>> boundaries;
+	std::vector<std::size_t> originalState; // state i is state originalState[i] of the data file
 
 	CSFS_Data(const std::string &);
+	CSFS_Data(const CSFS_Data &, const std::vector<std::size_t> &);
 
 	void checkParameters() const;
 	double elapsed_cpu_time() const;
@@ -90,6 +114,7 @@ public:
 	std::string exprMatrixString() const;
 	std::size_t maxNumCuts(const double) const;
 	std::string exprInfoString() const;
+	void writeBinary(const std::string &) const;
 
 	std::size_t getHighIndex() const;
 	std::size_t getNormIndex() const;
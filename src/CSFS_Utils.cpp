@@ -1,4 +1,7 @@
 #include "CSFS_Utils.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 
@@ -63,6 +66,95 @@ std::string CSFSUtils::getNthWord(const std::string &str, std::size_t n)
 }
 
 
+//------------------------------------------------------------------------------
+// Converts the characters in [begin, end) to a double, giving exactly the
+// value atof() would. Plain decimals with at most 15 significant digits and a
+// small exponent (which is what expression files hold) are converted without
+// copying the token: the digits form an exact integer and a single multiply or
+// divide by an exact power of ten is correctly rounded. Anything else is
+// handed to strtod().
+//------------------------------------------------------------------------------
+double CSFSUtils::parseDouble(const char *begin, const char *end)
+{
+  static const double powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                       1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                       1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  const char *p = begin;
+  const bool negative = (p != end && *p == '-');
+  if (p != end && (*p == '-' || *p == '+'))
+    ++p;
+
+  std::uint64_t mantissa = 0;
+  int numDigits = 0;     // significant digits in mantissa
+  int exponent = 0;
+  bool sawDigit = false;
+
+  for (; p != end && *p >= '0' && *p <= '9'; ++p)
+  {
+    sawDigit = true;
+    if (mantissa || *p != '0')
+    {
+      mantissa = mantissa * 10 + (*p - '0');
+      ++numDigits;
+    }
+  }
+
+  if (p != end && *p == '.')
+  {
+    for (++p; p != end && *p >= '0' && *p <= '9'; ++p)
+    {
+      sawDigit = true;
+      if (mantissa || *p != '0')
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        ++numDigits;
+      }
+      --exponent;
+    }
+  }
+
+  if (sawDigit && p != end && (*p == 'e' || *p == 'E'))
+  {
+    const char *q = p + 1;
+    const bool negativeExponent = (q != end && *q == '-');
+    if (q != end && (*q == '-' || *q == '+'))
+      ++q;
+
+    int value = 0;
+    bool sawExponentDigit = false;
+    for (; q != end && *q >= '0' && *q <= '9' && value < 10000; ++q)
+    {
+      sawExponentDigit = true;
+      value = value * 10 + (*q - '0');
+    }
+
+    if (sawExponentDigit)
+    {
+      exponent += negativeExponent ? -value : value;
+      p = q;
+    }
+  }
+
+  // *
+  // * Fall back to strtod() for anything outside the exact fast path
+  // *
+  if (!sawDigit || p != end || numDigits > 15 || exponent < -22 || exponent > 22)
+  {
+    const std::string token(begin, end);
+    return std::strtod(token.c_str(), NULL);
+  }
+
+  double value = static_cast<double>(mantissa);
+  if (exponent < 0)
+    value /= powersOfTen[-exponent];
+  else
+    value *= powersOfTen[exponent];
+
+  return negative ? -value : value;
+}
+
+
 //------------------------------------------------------------------------------
 // Precision round. Round num to an integer number of decimal points.
 // From https://stackoverflow.com/a/50404037
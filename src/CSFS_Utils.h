@@ -10,6 +10,7 @@ namespace CSFSUtils
   std::mt19937 createRng();
   std::size_t genRand();
   std::string getNthWord(const std::string &, std::size_t);
+  double parseDouble(const char *, const char *);
   double pround(const double, const std::size_t);
   unsigned long long rdtsc();
   std::mt19937* rng();
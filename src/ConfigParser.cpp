@@ -356,6 +356,17 @@ inline std::string ConfigParser::findValue(const std::string &parameterName) con
 }
 
 
+//------------------------------------------------------------------------------
+// Returns whether or not a value was given for the parameter. Used for
+// optional parameters, which fall back to a default when they are not provided
+//------------------------------------------------------------------------------
+bool ConfigParser::contains(const std::string &parameterName) const
+{
+  auto iter = values.find(parameterName);
+  return iter != values.end() && !iter->second.empty();
+}
+
+
 //------------------------------------------------------------------------------
 // Returns the value mapped to the parameter as a bool
 //------------------------------------------------------------------------------
@@ -19,6 +19,7 @@ class ConfigParser
     ConfigParser() {}
     ConfigParser(const std::string &filename) { load(filename); }
 
+    bool contains(const std::string &) const;
     bool getBool(const std::string &) const;
     char getChar(const std::string &) const;
     double getDouble(const std::string &) const;
@@ -49,7 +49,7 @@ CoverLpSolver::CoverLpSolver(const CSFS_Data &_data) : data(&_data),
     std::size_t numNonzeroStates = 0;
     for (std::size_t i = 0; i < data->numStates; ++i)
     {
-      if (data->exprs[i][j] == 1)
+      if (data->exprs(i, j))
         ++numNonzeroStates;
     }
 
@@ -100,7 +100,7 @@ void CoverLpSolver::buildModels()
   {
     IloExpr obj(env);
     for (std::size_t i = 0; i < data->numStates; ++i)
-      obj += mark[i] * data->exprs[i][j];
+      obj += mark[i] * data->exprs(i, j);
     model[j].add( IloMaximize(env, obj, "Objective") );
     obj.end();
   }
@@ -108,7 +108,7 @@ void CoverLpSolver::buildModels()
   {
     IloExpr obj(env);
     for (std::size_t i = 0; i < data->numStates; ++i)
-      obj += mark[i] * data->exprs[i][j];
+      obj += mark[i] * data->exprs(i, j);
     model[j].add( IloMinimize(env, obj, "Objective") );
     obj.end();
   }
@@ -229,7 +229,7 @@ void CoverLpSolver::setIndiv(const std::size_t j, const bool val)
   // *
   IloExpr expr(env);
   for (std::size_t i = 0; i < data->numStates; ++i)
-    expr += mark[i] * data->exprs[i][j];
+    expr += mark[i] * data->exprs(i, j);
 
   // *
   // * Add a constraint to fixedIndivConstraints
@@ -1,12 +1,30 @@
 #include "Cut.h"
-#include <cassert>
+#include <algorithm>
+
+namespace
+{
+  std::size_t numWordsFor(const std::size_t numBits)
+  {
+    return (numBits + 63) >> 6;
+  }
+
+  // Mask of the bits of the last word that hold elements
+  std::uint64_t lastWordMask(const std::size_t numBits)
+  {
+    return (numBits & 63) ? (std::uint64_t(1) << (numBits & 63)) - 1 : ~std::uint64_t(0);
+  }
+}
 
 //------------------------------------------------------------------------------
 //    Constructors
 //------------------------------------------------------------------------------
 // Default constructor
 //------------------------------------------------------------------------------
-Cut::Cut() : numMarkersInCut(0)
+Cut::Cut() : numElements_(0),
+             numMarkersInCut(0),
+             elementsValid(false),
+             hash_(0),
+             hashValid(false)
 {}
 
 
@@ -15,59 +33,68 @@ Cut::Cut() : numMarkersInCut(0)
 // If no initial state is provided, all items are set to false (i.e., not in the
 // cut).
 //------------------------------------------------------------------------------
-Cut::Cut(const std::size_t _numElements, const bool initial) : cut(_numElements, initial),
-                                                               numMarkersInCut(_numElements * initial)
-{}
+Cut::Cut(const std::size_t _numElements, const bool initial) : words(numWordsFor(_numElements), initial ? ~std::uint64_t(0) : 0),
+                                                               numElements_(_numElements),
+                                                               numMarkersInCut(_numElements * initial),
+                                                               elementsValid(false),
+                                                               hash_(0),
+                                                               hashValid(false)
+{
+  if (initial && !words.empty())
+    words.back() &= lastWordMask(numElements_);
+}
 
 
 //------------------------------------------------------------------------------
 // Creates a cut based on the given vector.
 //------------------------------------------------------------------------------
-Cut::Cut(const std::vector<bool> &vec) : cut(vec.size()),
-                                         numMarkersInCut(0)
+Cut::Cut(const std::vector<bool> &vec) : words(numWordsFor(vec.size()), 0),
+                                         numElements_(vec.size()),
+                                         numMarkersInCut(0),
+                                         elementsValid(false),
+                                         hash_(0),
+                                         hashValid(false)
 {
-  for (std::size_t i = 0; i < cut.size(); ++i)
-  {
-    cut[i] = vec[i];
-    if (vec[i])
-      ++numMarkersInCut;
-  }
+  set(vec);
 }
 
 
 //------------------------------------------------------------------------------
 // Creates a cut based on the given vector.
 //------------------------------------------------------------------------------
-Cut::Cut(const std::vector<char> &vec) : cut(vec.size()),
-                                         numMarkersInCut(0)
+Cut::Cut(const std::vector<char> &vec) : words(numWordsFor(vec.size()), 0),
+                                         numElements_(vec.size()),
+                                         numMarkersInCut(0),
+                                         elementsValid(false),
+                                         hash_(0),
+                                         hashValid(false)
 {
-  for (std::size_t i = 0; i < cut.size(); ++i)
-  {
-    cut[i] = vec[i];
-    if (vec[i])
-      ++numMarkersInCut;
-  }
+  set(vec);
 }
 
 
 //------------------------------------------------------------------------------
 //    Copy constructor
 //------------------------------------------------------------------------------
-Cut::Cut(const Cut &other) : cut(other.getBoolVector()),
-                             numMarkersInCut(other.size())
-{}
+Cut::Cut(const Cut &other) = default;
+
+
+//------------------------------------------------------------------------------
+//    Move constructor
+//------------------------------------------------------------------------------
+Cut::Cut(Cut &&other) noexcept = default;
 
 
 //------------------------------------------------------------------------------
 //    Copy assignment operator
 //------------------------------------------------------------------------------
-Cut & Cut::operator=(const Cut &other)
-{
-  cut = other.getBoolVector();
-  numMarkersInCut = other.size();
+Cut & Cut::operator=(const Cut &other) = default;
 
-  return *this;
-}
+
+//------------------------------------------------------------------------------
+//    Move assignment operator
+//------------------------------------------------------------------------------
+Cut & Cut::operator=(Cut &&other) noexcept = default;
 
 
 //------------------------------------------------------------------------------
@@ -76,10 +103,14 @@ Cut & Cut::operator=(const Cut &other)
 //------------------------------------------------------------------------------
 bool Cut::add(const std::size_t i)
 {
-  if (!cut[i])
+  assert(i < numElements_);
+
+  const std::uint64_t bit = std::uint64_t(1) << (i & 63);
+  if (!(words[i >> 6] & bit))
   {
-    cut[i] = true;
+    words[i >> 6] |= bit;
     ++numMarkersInCut;
+    changed();
     return true;
   }
 
@@ -92,39 +123,34 @@ bool Cut::add(const std::size_t i)
 //------------------------------------------------------------------------------
 std::size_t Cut::cardinalityOfIntersection(const Cut &other) const
 {
-  assert(cut.size() == other.numElements());
+  assert(numElements_ == other.numElements());
 
   std::size_t cardinality = 0;
-
-  if (numMarkersInCut < other.size())
-  {
-    for (std::size_t i = 0; i < cut.size(); ++i)
-    {
-      if (cut[i] && other[i])
-        ++cardinality;
-    }
-  }
-  else
-  {
-    for (std::size_t i = 0; i < cut.size(); ++i)
-    {
-      if (other[i] && cut[i])
-        ++cardinality;
-    }
-  }
+  for (std::size_t w = 0; w < words.size(); ++w)
+    cardinality += __builtin_popcountll(words[w] & other.words[w]);
 
   return cardinality;
 }
 
 
+//------------------------------------------------------------------------------
+// Forgets the cached element list and hash after the cut changes
+//------------------------------------------------------------------------------
+inline void Cut::changed()
+{
+  elementsValid = false;
+  hashValid = false;
+}
+
+
 //------------------------------------------------------------------------------
 // Removes all markers from the cut, but keeps the size of the vector the same.
 //------------------------------------------------------------------------------
 void Cut::clear()
 {
   numMarkersInCut = 0;
-  for (std::size_t i = 0; i < cut.size(); ++i)
-    cut[i] = false;
+  std::fill(std::begin(words), std::end(words), 0);
+  changed();
 }
 
 
@@ -134,14 +160,12 @@ void Cut::clear()
 //------------------------------------------------------------------------------
 std::size_t Cut::distance(const Cut &other) const
 {
-  assert(cut.size() == other.numElements());
+  assert(numElements_ == other.numElements());
 
   std::size_t x = 0;
-  for (std::size_t i = 0; i < cut.size(); ++i)
-  {
-    if (cut[i] != other[i])
-      ++x;
-  }
+  for (std::size_t w = 0; w < words.size(); ++w)
+    x += __builtin_popcountll(words[w] ^ other.words[w]);
+
   return x;
 }
 
@@ -161,8 +185,8 @@ bool Cut::empty() const
 std::string Cut::getBinaryString() const
 {
   std::ostringstream oss;
-  for (std::size_t i = 0; i < cut.size(); ++i)
-    oss << cut[i] << " ";
+  for (std::size_t i = 0; i < numElements_; ++i)
+    oss << (*this)[i] << " ";
   return oss.str();
 }
 
@@ -171,7 +195,11 @@ std::string Cut::getBinaryString() const
 //------------------------------------------------------------------------------
 std::vector<bool> Cut::getBoolVector() const
 {
-  return cut;
+  std::vector<bool> vec(numElements_, false);
+  const std::vector<std::size_t> &trueElements = getTrueElements();
+  for (std::size_t k = 0; k < trueElements.size(); ++k)
+    vec[trueElements[k]] = true;
+  return vec;
 }
 
 
@@ -180,27 +208,37 @@ std::vector<bool> Cut::getBoolVector() const
 //------------------------------------------------------------------------------
 std::vector<char> Cut::getCharVector() const
 {
-  std::vector<char> vec(cut.size());
-  for (std::size_t i = 0; i < cut.size(); ++i)
-    vec[i] = cut[i];
+  std::vector<char> vec(numElements_, 0);
+  const std::vector<std::size_t> &trueElements = getTrueElements();
+  for (std::size_t k = 0; k < trueElements.size(); ++k)
+    vec[trueElements[k]] = 1;
   return vec;
 }
 
 
 //------------------------------------------------------------------------------
-// Returns the location of the true elements as vector
+// Returns the location of the true elements in increasing order. The list is
+// built on the first call after the cut changes.
 //------------------------------------------------------------------------------
-std::vector<std::size_t> Cut::getTrueElements() const
+const std::vector<std::size_t> &Cut::getTrueElements() const
 {
-   std::vector<std::size_t>	vec;
-   for (std::size_t i = 0; i < cut.size(); ++i)
-   {
-      if(cut[i])
+  if (!elementsValid)
+  {
+    elements.clear();
+    elements.reserve(numMarkersInCut);
+    for (std::size_t w = 0; w < words.size(); ++w)
+    {
+      std::uint64_t word = words[w];
+      while (word)
       {
-		    vec.push_back(i);
+        elements.push_back((w << 6) + __builtin_ctzll(word));
+        word &= word - 1;
       }
-   }
-  return vec;
+    }
+    elementsValid = true;
+  }
+
+  return elements;
 }
 
 
@@ -210,12 +248,52 @@ std::vector<std::size_t> Cut::getTrueElements() const
 std::string Cut::getMarkerNumberString() const
 {
   std::ostringstream oss;
-  for (std::size_t i = 0; i < cut.size(); ++i)
+  const std::vector<std::size_t> &trueElements = getTrueElements();
+  for (std::size_t k = 0; k < trueElements.size(); ++k)
+    oss << trueElements[k] << " ";
+  return oss.str();
+}
+
+
+//------------------------------------------------------------------------------
+// Returns a hash of the marker states in the cut. The hash is computed on the
+// first call after the cut changes.
+//------------------------------------------------------------------------------
+std::size_t Cut::hash() const
+{
+  if (!hashValid)
   {
-    if (cut[i])
-      oss << i << " ";
+    std::uint64_t h = numElements_ * 0x9E3779B97F4A7C15ULL;
+    for (std::size_t w = 0; w < words.size(); ++w)
+    {
+      h ^= words[w] + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+      h *= 0xBF58476D1CE4E5B9ULL;
+    }
+    hash_ = static_cast<std::size_t>(h ^ (h >> 31));
+    hashValid = true;
   }
-  return oss.str();
+
+  return hash_;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns true if every marker in this cut is also in the other cut
+//------------------------------------------------------------------------------
+bool Cut::isSubsetOf(const Cut &other) const
+{
+  assert(numElements_ == other.numElements());
+
+  if (numMarkersInCut > other.size())
+    return false;
+
+  for (std::size_t w = 0; w < words.size(); ++w)
+  {
+    if (words[w] & ~other.words[w])
+      return false;
+  }
+
+  return true;
 }
 
 
@@ -224,7 +302,7 @@ std::string Cut::getMarkerNumberString() const
 //------------------------------------------------------------------------------
 std::size_t Cut::numElements() const
 {
-  return cut.size();
+  return numElements_;
 }
 
 
@@ -235,12 +313,14 @@ std::size_t Cut::numElements() const
 //------------------------------------------------------------------------------
 bool Cut::remove(const std::size_t i)
 {
-  assert(i < cut.size());
+  assert(i < numElements_);
 
-  if (cut[i])
+  const std::uint64_t bit = std::uint64_t(1) << (i & 63);
+  if (words[i >> 6] & bit)
   {
-    cut[i] = false;
+    words[i >> 6] &= ~bit;
     --numMarkersInCut;
+    changed();
     return true;
   }
 
@@ -254,22 +334,7 @@ bool Cut::remove(const std::size_t i)
 //------------------------------------------------------------------------------
 bool Cut::set(const std::size_t i, const bool state)
 {
-  assert(i < cut.size());
-
-  if (cut[i] == 0 && state == 1)
-  {
-    cut[i] = 1;
-    ++numMarkersInCut;
-    return true;
-  }
-  else if (cut[i] == 1 && state == 0)
-  {
-    cut[i] = 0;
-    --numMarkersInCut;
-    return true;
-  }
-
-  return false;
+  return state ? add(i) : remove(i);
 }
 
 
@@ -278,14 +343,16 @@ bool Cut::set(const std::size_t i, const bool state)
 //------------------------------------------------------------------------------
 void Cut::set(const std::vector<bool> &vec)
 {
-  assert(cut.size() == vec.size());
+  assert(numElements_ == vec.size());
 
-  numMarkersInCut = 0;
-  for (std::size_t i = 0; i < cut.size(); ++i)
+  clear();
+  for (std::size_t i = 0; i < numElements_; ++i)
   {
-    cut[i] = vec[i];
-    if (cut[i])
+    if (vec[i])
+    {
+      words[i >> 6] |= std::uint64_t(1) << (i & 63);
       ++numMarkersInCut;
+    }
   }
 }
 
@@ -295,24 +362,35 @@ void Cut::set(const std::vector<bool> &vec)
 //------------------------------------------------------------------------------
 void Cut::set(const std::vector<char> &vec)
 {
-  assert(cut.size() == vec.size());
+  assert(numElements_ == vec.size());
 
-  numMarkersInCut = 0;
-  for (std::size_t i = 0; i < cut.size(); ++i)
+  clear();
+  for (std::size_t i = 0; i < numElements_; ++i)
   {
-    cut[i] = vec[i];
-    if (cut[i])
+    if (vec[i])
+    {
+      words[i >> 6] |= std::uint64_t(1) << (i & 63);
       ++numMarkersInCut;
+    }
   }
 }
 
 
 //------------------------------------------------------------------------------
-// Changes the number of total elements to i
+// Changes the number of total elements to i. Markers past the new end are
+// dropped from the cut.
 //------------------------------------------------------------------------------
 void Cut::setNumElements(const std::size_t i)
 {
-  cut.resize(i, false);
+  words.resize(numWordsFor(i), 0);
+  numElements_ = i;
+  if (!words.empty())
+    words.back() &= lastWordMask(numElements_);
+
+  numMarkersInCut = 0;
+  for (std::size_t w = 0; w < words.size(); ++w)
+    numMarkersInCut += __builtin_popcountll(words[w]);
+  changed();
 }
 
 
@@ -326,6 +404,23 @@ std::size_t Cut::size() const
 }
 
 
+//------------------------------------------------------------------------------
+// Adds every marker in the other cut to this cut
+//------------------------------------------------------------------------------
+void Cut::unite(const Cut &other)
+{
+  assert(numElements_ == other.numElements());
+
+  numMarkersInCut = 0;
+  for (std::size_t w = 0; w < words.size(); ++w)
+  {
+    words[w] |= other.words[w];
+    numMarkersInCut += __builtin_popcountll(words[w]);
+  }
+  changed();
+}
+
+
 //------------------------------------------------------------------------------
 // Overload ==
 // If all the data members have the same value, the two are equal.
@@ -333,40 +428,36 @@ std::size_t Cut::size() const
 bool Cut::operator==(const Cut &rhs) const
 {
   if (numMarkersInCut != rhs.size()
-  ||  cut.size() != rhs.numElements())
+  ||  numElements_ != rhs.numElements())
   {
     return false;
   }
 
-  for (std::size_t i = 0; i < cut.size(); ++i)
-  {
-    if (cut[i] != rhs[i])
-      return false;
-  }
+  if (hashValid && rhs.hashValid && hash_ != rhs.hash_)
+    return false;
 
-  return true;
+  return words == rhs.words;
 }
 
 
 //------------------------------------------------------------------------------
 // Overload <
-// Return true if the size of the cut is smaller than the right hand side.
+// Return true if the size of the cut is smaller than the right hand side. Cuts
+// of the same size are ordered by the first marker state in which they differ:
+// the cut without that state is smaller.
 //------------------------------------------------------------------------------
 bool Cut::operator<(const Cut &rhs) const
 {
-  assert(cut.size() == rhs.numElements());
+  assert(numElements_ == rhs.numElements());
 
-  if (numMarkersInCut == rhs.size())
-  {
-    for (std::size_t i = 0; i < cut.size(); ++i)
-    {
-      if (cut[i] != rhs[i])
-        return cut[i] < rhs[i];
-    }
-  }
-  else
-  {
+  if (numMarkersInCut != rhs.size())
     return numMarkersInCut < rhs.size();
+
+  for (std::size_t w = 0; w < words.size(); ++w)
+  {
+    const std::uint64_t diff = words[w] ^ rhs.words[w];
+    if (diff)
+      return !(words[w] & diff & (~diff + 1)); // lowest differing bit
   }
   return false;
 }
@@ -378,31 +469,5 @@ bool Cut::operator<(const Cut &rhs) const
 //------------------------------------------------------------------------------
 bool Cut::operator>(const Cut &rhs) const
 {
-  assert(cut.size() == rhs.numElements());
-
-  if (numMarkersInCut == rhs.size())
-  {
-    for (std::size_t i = 0; i < cut.size(); ++i)
-    {
-      if (cut[i] != rhs[i])
-        return cut[i] > rhs[i];
-    }
-  }
-  else
-  {
-    return numMarkersInCut > rhs.size();
-  }
-  return false;
+  return rhs < *this;
 }
-
-
-//------------------------------------------------------------------------------
-// Returns whether or not the given element is in the cut.
-//------------------------------------------------------------------------------
-bool Cut::operator[](const std::size_t i) const
-{
-  assert(i < cut.size());
-
-  return cut[i];
-}
-
@@ -1,21 +1,39 @@
 #ifndef CUT_H
 #define CUT_H
 
+#include <cassert>
+#include <cstdint>
 #include <sstream>
 #include <vector>
 
+// *
+// * A cut is a set of marker states, stored as packed 64-bit words. The sorted
+// * list of states in the cut and the hash are built on first use and kept
+// * until the cut changes, so a cut that is read from several threads must
+// * have had them built first (or be copied per thread).
+// *
 class Cut {
   private:
-    std::vector<bool> cut;
+    std::vector<std::uint64_t> words;
+    std::size_t numElements_;    // the number of marker states the cut can hold
     std::size_t numMarkersInCut; // the number of elements in the array set to true
 
+    mutable std::vector<std::size_t> elements; // sorted states in the cut, valid if elementsValid
+    mutable bool elementsValid;
+    mutable std::size_t hash_;                 // valid if hashValid
+    mutable bool hashValid;
+
+    void changed();
+
   public:
     Cut();
     Cut(const std::size_t, const bool = 0);
     Cut(const std::vector<bool> &);
     Cut(const std::vector<char> &);
     Cut(const Cut &);
+    Cut(Cut &&) noexcept;
     Cut & operator=(const Cut &);
+    Cut & operator=(Cut &&) noexcept;
 
     bool add(const std::size_t);
     std::size_t cardinalityOfIntersection(const Cut &) const;
@@ -25,8 +43,10 @@ class Cut {
     std::string getBinaryString() const;
     std::vector<bool> getBoolVector() const;
     std::vector<char> getCharVector() const;
-    std::vector<std::size_t> getTrueElements() const;
+    const std::vector<std::size_t> &getTrueElements() const;
     std::string getMarkerNumberString() const;
+    std::size_t hash() const;
+    bool isSubsetOf(const Cut &) const;
     std::size_t numElements() const;
     bool remove(const std::size_t);
     bool set(const std::size_t, const bool);
@@ -34,11 +54,28 @@ class Cut {
     void set(const std::vector<char> &);
     void setNumElements(const std::size_t);
     std::size_t size() const;
+    void unite(const Cut &);
 
     bool operator==(const Cut &) const;
     bool operator<(const Cut &) const;
     bool operator>(const Cut &) const;
-    bool operator[](const std::size_t) const;
+
+    // Returns whether or not the given element is in the cut.
+    bool operator[](const std::size_t i) const
+    {
+      assert(i < numElements_);
+
+      return (words[i >> 6] >> (i & 63)) & 1;
+    }
+};
+
+
+struct CutHash
+{
+  std::size_t operator()(const Cut &cut) const
+  {
+    return cut.hash();
+  }
 };
 
 
@@ -60,4 +97,3 @@ struct SortCutsBySizeIncreasing
 };
 
 #endif
-
@@ -1,5 +1,24 @@
 #include "CutAndSolveController.h"
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <iomanip>
+#include <limits>
+
+namespace
+{
+  // Start of a checkpoint file written by writeCheckpoint(). Bump the version
+  // whenever the layout of the file changes.
+  const char CHECKPOINT_MAGIC[8] = {'C', 'S', 'F', 'S', 'C', 'K', 'P', '\0'};
+  const std::uint32_t CHECKPOINT_FORMAT_VERSION = 3;
+
+  // First line of a cutfile written by writeCutfileHeader(). The line is
+  // padded to a fixed width so it can be rewritten in place.
+  const std::string CUTFILE_HEADER = "# csfs cutfile";
+  const std::size_t CUTFILE_HEADER_WIDTH = 100;
+}
+
+const std::size_t CutAndSolveController::NO_GROUP = std::numeric_limits<std::size_t>::max();
 
 //------------------------------------------------------------------------------
 //    Constructor
@@ -12,13 +31,28 @@ CutAndSolveController::CutAndSolveController(const CSFS_Data &_data) : data(&_da
                                                               iter(0),
                                                               lb(data->STARTING_LOWER_BOUND),
                                                               ub(data->STARTING_UPPER_BOUND),
-                                                              totalSparseTime(0) {
+                                                              numSlots((world_size - 1) * data->WORKER_THREADS),
+                                                              sendBuffers(numSlots),
+                                                              sendRequests(numSlots, MPI_REQUEST_NULL),
+                                                              slotStats(numSlots),
+                                                              nextGroup(0),
+                                                              maxQueuedProblems(data->MAX_QUEUED_PROBLEMS),
+                                                              numLowerBoundSends(0),
+                                                              endSignalled(false),
+                                                              totalSparseTime(0),
+                                                              numProblemsSkipped(0),
+                                                              checkpointTimer(true),
+                                                              telemetry(_data) {
+  if (maxQueuedProblems == std::numeric_limits<std::size_t>::max()) // not given in the config file
+    maxQueuedProblems = numSlots;
+
   if (data->USE_SOLUTION_POOL_THRESHOLD && data->SOLUTION_POOL_THRESHOLD > lb) {
     lb = data->SOLUTION_POOL_THRESHOLD;
   }
 
-  for (std::size_t i = world_size - 1; i > 0; --i) {
-    availableWorkers.push(i);
+  // Slots are handed out round robin across the worker ranks
+  for (std::size_t s = numSlots; s > 0; --s) {
+    availableWorkers.push(s - 1);
   }
 
   logfile.open(data->logfileName.c_str());
@@ -26,24 +60,20 @@ CutAndSolveController::CutAndSolveController(const CSFS_Data &_data) : data(&_da
     throw std::runtime_error("Logfile could not be opened");
   }
 
+  if (data->WRITE_CUTS_FILE) {
+    cutfile.open(data->outputCutfileName.c_str());
+    if (!cutfile.is_open())
+      throw std::runtime_error("Output cutfile could not be opened");
+    writeCutfileHeader();
+  }
+
   // *
   // * Set up the vector of Markers
   // *
   markers.reserve(data->numStates);
   for (std::size_t i = 0; i < data->numStates; ++i) {
-    std::size_t numGrpOneCarrying = 0;
-    std::size_t numGrpTwoCarrying = 0;
-
-    for (std::size_t j = data->grpOneStart; j <= data->grpOneEnd; ++j) {
-      if (data->exprs[i][j]) {
-        ++numGrpOneCarrying;
-      }
-    }
-    for (std::size_t j = data->grpTwoStart; j <= data->grpTwoEnd; ++j) {
-      if (data->exprs[i][j]) {
-        ++numGrpTwoCarrying;
-      }
-    }
+    const std::size_t numGrpOneCarrying = data->exprs.countCarrying(i, data->grpOneStart, data->grpOneEnd);
+    const std::size_t numGrpTwoCarrying = data->exprs.countCarrying(i, data->grpTwoStart, data->grpTwoEnd);
     markers.emplace_back(i, numGrpOneCarrying, numGrpTwoCarrying);
   }
 
@@ -53,12 +83,7 @@ CutAndSolveController::CutAndSolveController(const CSFS_Data &_data) : data(&_da
   individuals.reserve(data->numIndiv);
   for (std::size_t j = 0; j < data->numIndiv; ++j) {
     // Count the number of nonzero marker states for this individual
-    std::size_t numNonzeroStates = 0;
-    for (std::size_t i = 0; i < data->numStates; ++i) {
-      if (data->exprs[i][j] == 1) {
-        ++numNonzeroStates;
-      }
-    }
+    const std::size_t numNonzeroStates = data->exprs.countStates(j);
 
     // Determine the group number
     const short group = (j >= data->grpOneStart && j <= data->grpOneEnd) ? 1 : 2;
@@ -94,6 +119,70 @@ bool CutAndSolveController::converged() const {
 }
 
 
+//------------------------------------------------------------------------------
+// Returns true if the sparse problem of a cut can't find a pattern, so it
+// needn't be solved. A pattern at or above the lower bound only holds states
+// that aren't fixed to 0 and are carried by enough group one individuals.
+// If fewer than PATTERN_SIZE of the cut's states are left, no pattern reaches
+// the bound. If they are all within a cut of the cut set, every pattern of
+// them is (or was) searched by that cut's sparse problem, and subsumed is
+// set. The cut set's index makes this an AND of one bitset per state.
+//------------------------------------------------------------------------------
+inline bool CutAndSolveController::answerIsKnown(const Cut &cut, bool *subsumed) const {
+  const double minRatio = (data->USE_SOLUTION_POOL_THRESHOLD ? data->SOLUTION_POOL_THRESHOLD : std::max(lb, data->TOL)) - data->TOL;
+
+  std::vector<std::size_t> states;
+  const std::vector<std::size_t> &elements = cut.getTrueElements();
+  for (auto it = std::begin(elements); it != std::end(elements); ++it) {
+    if (!markers[*it].isZero()
+    &&  markers[*it].getNumGrpOneCarrying() / static_cast<double>(data->numGrpOne) >= minRatio)
+      states.push_back(*it);
+  }
+
+  *subsumed = false;
+  if (states.size() < data->setSize)
+    return true;
+
+  *subsumed = cutSet.exists(states);
+  return *subsumed;
+}
+
+
+//------------------------------------------------------------------------------
+// Sends queued problems to workers until either the queue is empty or no
+// workers are available
+//------------------------------------------------------------------------------
+inline void CutAndSolveController::dispatchProblems() {
+  while (!problemQueue.empty() && !availableWorkers.empty()) {
+    const int slot = availableWorkers.top();
+    if (!data->QUIET)
+      std::cout << "Sending queued problem to rank_" << rankOfSlot(slot) << std::endl;
+
+    sendProblem(&problemQueue.front());
+    problemQueue.pop_front();
+
+    ProblemStats &stats = slotStats[slot];
+    stats = queuedStats.front();
+    stats.sentAt = data->elapsed_wall_time();
+    queuedStats.pop_front();
+
+    if (telemetry.enabled()) {
+      telemetry.begin("sent");
+      telemetry.add("iter", stats.iter);
+      telemetry.add("slot", slot);
+      telemetry.add("rank", rankOfSlot(slot));
+      telemetry.add("cut_size", stats.cutSize);
+      telemetry.add("bytes", sendBuffers[slot].size());
+      telemetry.add("queue_wait", stats.sentAt - stats.queuedAt);
+      telemetry.add("queued", problemQueue.size());
+      if (stats.group != NO_GROUP)
+        telemetry.add("group", stats.group);
+      telemetry.end();
+    }
+  }
+}
+
+
 //------------------------------------------------------------------------------
 // Returns the lower bound
 //------------------------------------------------------------------------------
@@ -107,13 +196,21 @@ double CutAndSolveController::getLb() const {
 std::string CutAndSolveController::getStringOfUnavailableWorkers() const {
   std::ostringstream oss;
   for (auto it = std::begin(unavailableWorkers); it != std::end(unavailableWorkers); ++it) {
-    oss << *it << " ";
+    oss << rankOfSlot(*it) << " ";
   }
 
   return oss.str();
 }
 
 
+//------------------------------------------------------------------------------
+// Returns the CPU seconds the workers have spent solving sparse problems
+//------------------------------------------------------------------------------
+double CutAndSolveController::getTotalSparseTime() const {
+  return totalSparseTime;
+}
+
+
 //------------------------------------------------------------------------------
 // Returns the upper bound
 //------------------------------------------------------------------------------
@@ -130,73 +227,214 @@ std::size_t CutAndSolveController::numWorkersWorking() const {
 }
 
 
+//------------------------------------------------------------------------------
+// Packs the sparse problem for a cut into a single message:
+//   format version, lower bound, slot, the cut to solve, the number of cuts in
+//   the cut set, each cut, the markers fixed to 0, the markers fixed to 1, the
+//   individuals fixed to 0, and the individuals fixed to 1
+//
+// The given states of the cut are fixed to 1 as well, so only the patterns
+// holding them are searched.
+//
+// The problem is a snapshot of the cut set and the fixed variables at the time
+// the cut was created. The lower bound is refreshed, and the slot filled in,
+// when the problem is sent.
+//------------------------------------------------------------------------------
+inline void CutAndSolveController::packProblem(const Cut &cut,
+                                               const std::vector<std::size_t> &forcedIn,
+                                               MessageBuffer *buffer) const {
+  buffer->clear();
+  buffer->putVersion();
+  assert(buffer->size() == LB_POSITION);
+  buffer->put(lb);
+  assert(buffer->size() == SLOT_POSITION);
+  buffer->put(static_cast<std::uint32_t>(0)); // filled in when the problem is sent
+  assert(buffer->size() == CUT_POSITION);
+  buffer->putIndexSet(cut.getTrueElements(), data->numStates);
+
+  buffer->put(static_cast<std::uint64_t>(cutSet.numCuts()));
+  for (auto it = cutSet.begin(); it != cutSet.end(); ++it)
+    buffer->putIndexSet(it->getTrueElements(), data->numStates);
+
+  // *
+  // * Markers and individuals not in either fixed set are determined by the
+  // * sparse problem
+  // *
+  {
+    std::vector<std::size_t> fixedToZero;
+    std::vector<std::size_t> fixedToOne(forcedIn);
+    for (std::size_t i = 0; i < markers.size(); ++i) {
+      if (markers[i].isZero())
+        fixedToZero.push_back(i);
+      else if (markers[i].isOne())
+        fixedToOne.push_back(i);
+    }
+    std::sort(std::begin(fixedToOne), std::end(fixedToOne));
+    fixedToOne.erase(std::unique(std::begin(fixedToOne), std::end(fixedToOne)), std::end(fixedToOne));
+    buffer->putIndexSet(fixedToZero, data->numStates);
+    buffer->putIndexSet(fixedToOne, data->numStates);
+  }
+  {
+    std::vector<std::size_t> fixedToZero;
+    std::vector<std::size_t> fixedToOne;
+    for (std::size_t j = 0; j < individuals.size(); ++j) {
+      if (individuals[j].isZero())
+        fixedToZero.push_back(j);
+      else if (individuals[j].isOne())
+        fixedToOne.push_back(j);
+    }
+    buffer->putIndexSet(fixedToZero, data->numIndiv);
+    buffer->putIndexSet(fixedToOne, data->numIndiv);
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Receives every completed sparse problem that has already arrived without
+// blocking, then hands queued problems to the workers that were freed
+//------------------------------------------------------------------------------
+inline void CutAndSolveController::pollCompletions() {
+  while (workersStillWorking()) {
+    int arrived = 0;
+    MPI_Iprobe(MPI_ANY_SOURCE, Parallel::SPARSE_TAG, MPI_COMM_WORLD, &arrived, MPI_STATUS_IGNORE);
+    if (!arrived)
+      break;
+
+    receiveCompletion();
+  }
+
+  dispatchProblems();
+}
+
+
+//------------------------------------------------------------------------------
+// Packs the sparse problem for a cut, with the given states fixed to 1, and
+// queues it for the next free worker
+//------------------------------------------------------------------------------
+inline void CutAndSolveController::queueProblem(const Cut &cut,
+                                                const std::vector<std::size_t> &forcedIn,
+                                                const std::size_t group) {
+  problemQueue.emplace_back();
+  packProblem(cut, forcedIn, &problemQueue.back());
+
+  ProblemStats stats;
+  stats.iter = iter;
+  stats.cutSize = cut.size();
+  stats.queuedAt = data->elapsed_wall_time();
+  stats.sentAt = 0;
+  stats.group = group;
+  queuedStats.push_back(stats);
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the rank of the worker that owns a slot
+//------------------------------------------------------------------------------
+inline int CutAndSolveController::rankOfSlot(const int slot) const {
+  return 1 + slot % (world_size - 1);
+}
+
+
 //------------------------------------------------------------------------------
 // Receives a completed sparse problem from a worker
 //------------------------------------------------------------------------------
 inline void CutAndSolveController::receiveCompletion() {
-  assert(availableWorkers.size() < world_size - 1); // Cannot receive problem when no workers are working
+  assert(availableWorkers.size() < numSlots); // Cannot receive problem when no workers are working
 
   MPI_Status status;
+  MessageBuffer buffer;
   double sparseRunTime;
   double bestObjValue = 0;
-  std::size_t sparseNumSol;
   std::vector<std::vector<std::size_t> > solutionPool;
   std::vector<double> objValues;
 
   // *
   // * Receive the solution
   // *
+  buffer.receive(MPI_ANY_SOURCE, Parallel::SPARSE_TAG, &status);
+  buffer.checkVersion();
+  const int slot = buffer.get<std::uint32_t>();
+  assert(slot >= 0 && static_cast<std::size_t>(slot) < numSlots && rankOfSlot(slot) == status.MPI_SOURCE);
 
-  MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
   #ifndef NDEBUG
-    
-    std::cout << "Controller about to receive completion from rank_" << status.MPI_SOURCE << std::endl;
+    std::cout << "Controller received completion (" << buffer.size()
+              << " bytes) from rank_" << status.MPI_SOURCE << std::endl;
   #endif
 
-  MPI_Recv(&sparseNumSol, 1, CUSTOM_SIZE_T, status.MPI_SOURCE, Parallel::SPARSE_TAG, MPI_COMM_WORLD, &status);
-  
-  #ifndef NDEBUG
-    if (sparseNumSol > 0)
-      std::cout << "Controller about to receive " << sparseNumSol << " solution vectors from rank_" << status.MPI_SOURCE << std::endl;
-  #endif
-  
+  const std::uint64_t sparseNumSol = buffer.get<std::uint64_t>();
   solutionPool.resize(sparseNumSol);
   objValues.resize(sparseNumSol);
   for (std::size_t i = 0; i < solutionPool.size(); ++i) {
-    MPI_Recv(&objValues[i], 1, MPI_DOUBLE, status.MPI_SOURCE, Parallel::SPARSE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-    #ifndef NDEBUG
-      std::cout << "Controller received objective value from rank_" << status.MPI_SOURCE << std::endl;
-    #endif
+    objValues[i] = buffer.get<double>();
     if (i == 0) {
       bestObjValue = objValues[i];
     } else if (objValues[i] > bestObjValue) {
       bestObjValue = objValues[i];
     }
-    
+
     solutionPool[i].resize(data->setSize);
-    MPI_Recv(&solutionPool[i][0], solutionPool[i].size(), CUSTOM_SIZE_T, status.MPI_SOURCE, Parallel::SPARSE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    for (std::size_t k = 0; k < solutionPool[i].size(); ++k)
+      solutionPool[i][k] = buffer.get<std::uint32_t>();
   }
 
-  #ifndef NDEBUG
-    if (sparseNumSol > 0)
-      std::cout << "Controller received all solution vectors from rank_" << status.MPI_SOURCE << std::endl;
-  #endif
+  sparseRunTime = buffer.get<double>();
+  const double sparseWallTime = buffer.get<double>();
+  const double workerWaitTime = buffer.get<double>();
+  const std::uint64_t numFreeMarkers = buffer.get<std::uint64_t>();
+  const std::uint64_t numFreeIndividuals = buffer.get<std::uint64_t>();
 
-  MPI_Recv(&sparseRunTime, 1, MPI_DOUBLE, status.MPI_SOURCE, Parallel::SPARSE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-  
-  #ifndef NDEBUG
-    std::cout << "Controller received the run time from rank_"
-              << status.MPI_SOURCE << "\nController received all info from rank_"
-              << status.MPI_SOURCE << std::endl;
-  #endif
+  // *
+  // * The problem sent to this worker has been solved, so its send is done
+  // *
+  MPI_Wait(&sendRequests[slot], MPI_STATUS_IGNORE);
 
   // *
   // * Update lower bound and statistics
   // *
+  const double prevLb = lb;
   if (!data->USE_SOLUTION_POOL_THRESHOLD) // Don't update bound if using solutions pool
     lb = std::max(bestObjValue, lb);
   totalSparseTime += sparseRunTime;  
+
+  // *
+  // * A split cut is solved once its last part is. The lower bound is
+  // * updated first, since the cutfile records it with the cut.
+  // *
+  const std::size_t group = slotStats[slot].group;
+  if (group == NO_GROUP) {
+    if (cutfile.is_open()) {
+      sendBuffers[slot].seek(CUT_POSITION);
+      writeSolvedCut(sendBuffers[slot].getIndexSet(data->numStates));
+    }
+  } else {
+    auto it = splitGroups.find(group);
+    assert(it != splitGroups.end() && it->second.numPartsLeft > 0);
+    if (--it->second.numPartsLeft == 0) {
+      if (cutfile.is_open())
+        writeSolvedCut(it->second.cut);
+      splitGroups.erase(it);
+    }
+  }
+
+  if (telemetry.enabled()) {
+    const ProblemStats &stats = slotStats[slot];
+    telemetry.begin("solved");
+    telemetry.add("iter", stats.iter);
+    telemetry.add("slot", slot);
+    telemetry.add("rank", status.MPI_SOURCE);
+    telemetry.add("bytes_sent", sendBuffers[slot].size());
+    telemetry.add("bytes_received", buffer.size());
+    telemetry.add("round_trip", data->elapsed_wall_time() - stats.sentAt);
+    telemetry.add("worker_wait", workerWaitTime);
+    telemetry.add("solve_wall", sparseWallTime);
+    telemetry.add("solve_cpu", sparseRunTime);
+    telemetry.add("free_markers", numFreeMarkers);
+    telemetry.add("free_individuals", numFreeIndividuals);
+    telemetry.add("solutions", sparseNumSol);
+    telemetry.add("best", bestObjValue);
+    telemetry.add("lb", lb);
+    telemetry.end();
+  }
   
   for (std::size_t i = 0; i < solutionPool.size(); ++i) {
     if (!data->QUIET)
@@ -213,109 +451,226 @@ inline void CutAndSolveController::receiveCompletion() {
   // *
   // * Make the worker available again
   // *
-  availableWorkers.push(status.MPI_SOURCE);
-  unavailableWorkers.erase(status.MPI_SOURCE);
+  availableWorkers.push(slot);
+  unavailableWorkers.erase(slot);
+
+  if (lb > prevLb && data->SHARE_LOWER_BOUND && !endSignalled)
+    shareLowerBound();
 }
 
 //------------------------------------------------------------------------------
-// Sends a problem to a worker
+// Writes the telemetry record of the whole run. Called once the workers have
+// finished.
 //------------------------------------------------------------------------------
-inline void CutAndSolveController::sendProblem(const Cut &cut)
+void CutAndSolveController::recordSummary()
 {
-  assert(!availableWorkers.empty()); // Cannot send problem with no available workers
+  if (!telemetry.enabled())
+    return;
+
+  telemetry.begin("summary");
+  telemetry.add("iterations", iter);
+  telemetry.add("num_cuts", cutSet.numCuts());
+  telemetry.add("lb", lb);
+  telemetry.add("ub", ub);
+  telemetry.add("sparse_cpu", totalSparseTime);
+  telemetry.add("lower_bound_sends", numLowerBoundSends);
+  telemetry.add("skipped_problems", numProblemsSkipped);
+  telemetry.end();
+}
+
+
+//------------------------------------------------------------------------------
+// Restores the search from a checkpoint written by writeCheckpoint(). The
+// controller must have just been constructed from the same data and config.
+// The relaxation is rebuilt from the saved cuts and fixed variables, and the
+// sparse problems that were unsolved when the checkpoint was written are
+// queued again.
+//------------------------------------------------------------------------------
+void CutAndSolveController::resume(const std::string &filename)
+{
+  const MappedFile file(filename);
+  if (file.size() < sizeof(CHECKPOINT_MAGIC) + sizeof(std::uint32_t)
+  ||  std::memcmp(file.begin(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)
+    throw std::runtime_error(filename + " is not a checkpoint file.");
+
+  MessageBuffer buffer;
+  buffer.assign(file.begin() + sizeof(CHECKPOINT_MAGIC), file.size() - sizeof(CHECKPOINT_MAGIC));
 
+  const std::uint32_t version = buffer.get<std::uint32_t>();
+  if (version != CHECKPOINT_FORMAT_VERSION)
+    throw std::runtime_error("Checkpoint has format version " + std::to_string(version)
+                             + ", expected " + std::to_string(CHECKPOINT_FORMAT_VERSION) + ".");
+
+  // *
+  // * The checkpoint must be of the same problem
   // *
-  // * Convert the cuts into transferable vectors
+  const std::uint64_t numStates = buffer.get<std::uint64_t>();
+  const std::uint64_t numIndiv = buffer.get<std::uint64_t>();
+  const std::uint64_t setSize = buffer.get<std::uint64_t>();
+  const bool risk = buffer.get<char>();
+  const bool usePool = buffer.get<char>();
+  if (numStates != data->numStates || numIndiv != data->numIndiv || setSize != data->setSize
+  ||  risk != data->RISK || usePool != data->USE_SOLUTION_POOL_THRESHOLD)
+    throw std::runtime_error("Checkpoint " + filename + " was written for a different data set or config file.");
+
   // *
-  const std::vector<char> convertedCut = cut.getCharVector();
-  const std::vector<std::vector<char> > convertedCuts = cutSet.get2dCharVector();
+  // * The saved cuts and fixings index the states kept by presolve, which
+  // * depend on the known pattern, so the same states must have been kept
+  // *
+  for (std::size_t i = 0; i < data->numStates; ++i)
+    if (buffer.get<std::uint64_t>() != data->originalState[i])
+      throw std::runtime_error("Checkpoint " + filename + " was written for a different set of presolved"
+                               " states. Resume with the same PATTERN_FILE and HEURISTIC_STARTS.");
+
+  iter = buffer.get<std::uint64_t>();
+  lb = std::max(lb, buffer.get<double>());
+  ub = std::min(ub, buffer.get<double>());
+  totalSparseTime = buffer.get<double>();
+  cc.setBasesCutsOnIndividuals(buffer.get<char>());
 
   // *
-  // * Convert the individuals' fixed statuses
-  // * If indiviudals[i] is fixed to 0, convertedIndiv[i] = 0
-  // * If indiviudals[i] is fixed to 1, convertedIndiv[i] = 1
-  // * If indiviudals[i] is not fixed to a value, convertedIndiv[i] = 2
+  // * Cuts
   // *
-  std::vector<char> convertedIndiv(data->numIndiv);
-  for (std::size_t j = 0; j < individuals.size(); ++j)
+  const std::uint64_t numCuts = buffer.get<std::uint64_t>();
+  for (std::uint64_t c = 0; c < numCuts; ++c)
   {
-    if (!individuals[j].isSet())
-      convertedIndiv[j] = 2;
-    else
-      convertedIndiv[j] = individuals[j].isZero() ? 0 : 1;
+    Cut cut(data->numStates);
+    const std::vector<std::size_t> elements = buffer.getIndexSet(data->numStates);
+    for (auto it = std::begin(elements); it != std::end(elements); ++it)
+      cut.add(*it);
+
+    cutSet.add(cut);
+    rs.add(cut);
   }
 
   // *
-  // * Convert the markers' fixed statuses
-  // * If markers[i] is fixed to 0, then convertedMark[i] = 0
-  // * If markers[i] is fixed to 1, then convertedMark[i] = 1
-  // * If markers[i] is not fixed to a value, then convertedMark[i] = 2
+  // * Fixed markers and individuals, then individual equalities
   // *
-  std::vector<char> convertedMark(data->numStates);
-  for (std::size_t i = 0; i < markers.size(); ++i)
   {
-    if (!markers[i].isSet())
-      convertedMark[i] = 2;
-    else
-      convertedMark[i] = markers[i].isZero() ? 0 : 1;
+    const std::vector<std::size_t> zero = buffer.getIndexSet(data->numStates);
+    const std::vector<std::size_t> one = buffer.getIndexSet(data->numStates);
+    for (auto it = std::begin(zero); it != std::end(zero); ++it)
+      setMark(*it, 0);
+    for (auto it = std::begin(one); it != std::end(one); ++it)
+      setMark(*it, 1);
+  }
+  {
+    const std::vector<std::size_t> zero = buffer.getIndexSet(data->numIndiv);
+    const std::vector<std::size_t> one = buffer.getIndexSet(data->numIndiv);
+    for (auto it = std::begin(zero); it != std::end(zero); ++it)
+      setIndiv(*it, 0);
+    for (auto it = std::begin(one); it != std::end(one); ++it)
+      setIndiv(*it, 1);
   }
 
-  const int worker = availableWorkers.top();
-  const std::size_t numCuts = convertedCuts.size();
+  const std::uint64_t numClasses = buffer.get<std::uint64_t>();
+  for (std::uint64_t c = 0; c < numClasses; ++c)
+  {
+    const std::vector<std::size_t> members = buffer.getIndexSet(data->numIndiv);
+    for (std::size_t k = 1; k < members.size(); ++k)
+    {
+      if (individualEqualities.add(members[0], members[k]))
+        rs.setIndivEquality(members[0], members[k]);
+    }
+  }
 
   // *
-  // * Send the problem
+  // * Unsolved sparse problems
   // *
-  MPI_Send(&lb, 1, MPI_DOUBLE, worker, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
-
-  #ifndef NDEBUG
-    std::cout << "Controller sent the lower bound to rank_" << worker << std::endl;
-  #endif
+  const std::uint64_t numProblems = buffer.get<std::uint64_t>();
+  for (std::uint64_t p = 0; p < numProblems; ++p)
+  {
+    const std::uint64_t group = buffer.get<std::uint64_t>();
+    std::vector<char> bytes(buffer.get<std::uint64_t>());
+    buffer.getArray(bytes.data(), bytes.size());
+    problemQueue.emplace_back();
+    problemQueue.back().assign(bytes.data(), bytes.size());
+
+    ProblemStats stats;
+    stats.iter = iter;
+    problemQueue.back().seek(CUT_POSITION);
+    stats.cutSize = problemQueue.back().getIndexSet(data->numStates).size();
+    stats.queuedAt = data->elapsed_wall_time();
+    stats.sentAt = 0;
+    stats.group = group;
+    queuedStats.push_back(stats);
+  }
 
-  MPI_Send(&convertedCut[0], convertedCut.size(), MPI_CHAR, worker, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
+  // *
+  // * Split cuts whose parts are not all solved
+  // *
+  const std::uint64_t numGroups = buffer.get<std::uint64_t>();
+  for (std::uint64_t g = 0; g < numGroups; ++g)
+  {
+    const std::uint64_t group = buffer.get<std::uint64_t>();
+    SplitGroup &split = splitGroups[group];
+    split.numPartsLeft = buffer.get<std::uint64_t>();
+    split.cut = buffer.getIndexSet(data->numStates);
+    nextGroup = std::max<std::size_t>(nextGroup, group + 1);
+  }
 
-  #ifndef NDEBUG
-    std::cout << "Controller sent the cut to rank_" << worker << std::endl;
-  #endif
+  if (!data->QUIET)
+    std::cout << "Resumed from " << filename << " at iteration " << iter << " with "
+              << cutSet.numCuts() << " cuts and " << problemQueue.size()
+              << " unsolved sparse problems\n"
+              << CSFS::getStringOfEndOfIterInfo(ub, lb, data->elapsed_cpu_time())
+              << "\n" << std::endl;
 
-  MPI_Send(&numCuts, 1, CUSTOM_SIZE_T, worker, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
+  dispatchProblems();
+}
 
-  #ifndef NDEBUG
-    std::cout << "Controller sent the size of the cut set to rank_" << worker << std::endl;
-  #endif
 
-  for (std::size_t i = 0; i < convertedCuts.size(); ++i)
-    MPI_Send(&convertedCuts[i][0], convertedCuts[i].size(), MPI_CHAR, worker, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
+//------------------------------------------------------------------------------
+// Sends a packed problem to a worker. The problem is swapped into the worker's
+// send buffer, so it is left empty.
+//------------------------------------------------------------------------------
+inline void CutAndSolveController::sendProblem(MessageBuffer *problem)
+{
+  assert(!availableWorkers.empty()); // Cannot send problem with no available workers
 
-  #ifndef NDEBUG
-    std::cout << "Controller sent the cut set to rank_" << worker << std::endl;
-  #endif
+  const int slot = availableWorkers.top();
+  const int worker = rankOfSlot(slot);
+  MessageBuffer &buffer = sendBuffers[slot];
 
-  MPI_Send(&convertedMark[0], convertedMark.size(), MPI_CHAR, worker, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
+  // *
+  // * The slot's previous problem was solved, so the send of that problem
+  // * has completed and its buffer can be reused
+  // *
+  MPI_Wait(&sendRequests[slot], MPI_STATUS_IGNORE);
 
-  #ifndef NDEBUG
-    std::cout << "Controller sent the vector of markers to rank_" << worker << std::endl;
-  #endif
+  std::swap(buffer, *problem);
+  buffer.putAt(LB_POSITION, lb); // the lower bound may have improved since the problem was packed
+  buffer.putAt(SLOT_POSITION, static_cast<std::uint32_t>(slot));
 
-  MPI_Send(&convertedIndiv[0], convertedIndiv.size(), MPI_CHAR, worker, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
+  // *
+  // * Send the problem
+  // *
+  buffer.isend(worker, Parallel::SPARSE_TAG, &sendRequests[slot]);
 
   #ifndef NDEBUG
-    std::cout << "Controller sent the vector of individuals to rank_" << worker
-              << "\nController sent all info to rank_" << worker <<  std::endl;
+    std::cout << "Controller sent the problem (" << buffer.size()
+              << " bytes) to rank_" << worker << std::endl;
   #endif
 
   // *
   // * Make the worker unavailable
   // *
   availableWorkers.pop();
-  unavailableWorkers.insert(worker);
+  unavailableWorkers.insert(slot);
 }
 
 
 //------------------------------------------------------------------------------
-// Splits up a single sparse problem into multiple sparse problems and sends
-// them to workers. If all workers are working, then problems are sent as workers
-// finish their current problems.
+// Queues the sparse problem for a cut for the next free worker. The controller
+// only waits for a worker to finish when the queue is full, so it can keep
+// solving relaxations and creating cuts while all workers are busy. Problems
+// whose answer is known aren't queued (see answerIsKnown()).
+//
+// A cut of at least SPLIT_MIN_CUT_SIZE states is split into one part for
+// each worker that would otherwise be idle. With s1, s2, ... the free states
+// of the cut carried by the most group one individuals, part k holds the
+// patterns with sk but none of s1 to s(k-1), and the last part those with
+// none of them. The parts are disjoint, so no pattern is found twice.
 //------------------------------------------------------------------------------
 inline void CutAndSolveController::sendProblems(Cut cut)
 {
@@ -326,13 +681,108 @@ inline void CutAndSolveController::sendProblems(Cut cut)
   for (auto it = std::begin(markersInAllCuts); it != std::end(markersInAllCuts); ++it)
     cut.remove(*it);
 
-  if (availableWorkers.empty()) // wait for a free worker
+  // *
+  // * Skip a problem whose answer is already known. A cut within an earlier
+  // * cut is left out of the cutfile, since that cut may not be solved yet.
+  // *
+  bool subsumed;
+  if (answerIsKnown(cut, &subsumed)) {
+    ++numProblemsSkipped;
+    if (!subsumed && cutfile.is_open())
+      writeSolvedCut(cut.getTrueElements());
+
+    if (!data->QUIET)
+      std::cout << "\nSkipped cut (" << (subsumed ? "within an earlier cut" : "cannot reach the lower bound") << ")\n"
+                << cut.getMarkerNumberString() << std::endl;
+
+    pollCompletions();
+    return;
+  }
+
+  // *
+  // * States to split on, if there are idle workers to give the parts to
+  // *
+  std::vector<std::size_t> splitStates;
+  const std::size_t numIdle = availableWorkers.size() > problemQueue.size() ? availableWorkers.size() - problemQueue.size() : 0;
+  if (data->SPLIT_MIN_CUT_SIZE > 0 && cut.size() >= data->SPLIT_MIN_CUT_SIZE && numIdle > 1) {
+    const std::vector<std::size_t> &elements = cut.getTrueElements();
+    for (auto it = std::begin(elements); it != std::end(elements); ++it) {
+      if (!markers[*it].isSet())
+        splitStates.push_back(*it);
+    }
+
+    const std::size_t numSplitStates = std::min(numIdle - 1, std::min(splitStates.size(), cut.size() - data->setSize));
+    std::partial_sort(std::begin(splitStates), std::begin(splitStates) + numSplitStates, std::end(splitStates),
+                      [this](const std::size_t a, const std::size_t b) {
+                        const std::size_t coverageA = markers[a].getNumGrpOneCarrying();
+                        const std::size_t coverageB = markers[b].getNumGrpOneCarrying();
+                        return coverageA > coverageB || (coverageA == coverageB && a < b);
+                      });
+    splitStates.resize(numSplitStates);
+  }
+
+  if (splitStates.empty()) {
+    queueProblem(cut, std::vector<std::size_t>(), NO_GROUP);
+  } else {
+    SplitGroup &split = splitGroups[nextGroup];
+    split.cut = cut.getTrueElements();
+    split.numPartsLeft = splitStates.size() + 1;
+
+    Cut part(cut);
+    for (auto it = std::begin(splitStates); it != std::end(splitStates); ++it) {
+      queueProblem(part, std::vector<std::size_t>(1, *it), nextGroup);
+      part.remove(*it);
+    }
+    queueProblem(part, std::vector<std::size_t>(), nextGroup);
+    ++nextGroup;
+  }
+
+  if (!data->QUIET) {
+    std::cout << "\nQueued cut (" << problemQueue.size() << " problems waiting)";
+    if (!splitStates.empty())
+      std::cout << " split into " << splitStates.size() + 1 << " parts";
+    std::cout << "\n" << cut.getMarkerNumberString() << std::endl;
+  }
+
+  pollCompletions();
+
+  while (problemQueue.size() > maxQueuedProblems) { // wait for a free worker
     receiveCompletion();
-  
-  if (!data->QUIET)
-    std::cout << "\nSending cut to rank_" << availableWorkers.top() << "\n" << cut.getMarkerNumberString() << std::endl;
+    dispatchProblems();
+  }
+}
+
 
-  sendProblem(cut);  
+//------------------------------------------------------------------------------
+// Sends the lower bound to every worker rank that is solving a problem, so
+// the searches already running can prune against it. The sends don't block,
+// and their buffers are released once they complete.
+//------------------------------------------------------------------------------
+inline void CutAndSolveController::shareLowerBound()
+{
+  for (auto it = std::begin(lowerBoundSends); it != std::end(lowerBoundSends);) {
+    int done = 0;
+    MPI_Test(&it->second, &done, MPI_STATUS_IGNORE);
+    if (done)
+      it = lowerBoundSends.erase(it);
+    else
+      ++it;
+  }
+
+  std::set<int> ranks;
+  for (auto it = std::begin(unavailableWorkers); it != std::end(unavailableWorkers); ++it)
+    ranks.insert(rankOfSlot(*it));
+
+  for (auto it = std::begin(ranks); it != std::end(ranks); ++it) {
+    lowerBoundSends.emplace_back(lb, MPI_REQUEST_NULL);
+    MPI_Isend(&lowerBoundSends.back().first, 1, MPI_DOUBLE, *it, Parallel::LOWER_BOUND_TAG,
+              MPI_COMM_WORLD, &lowerBoundSends.back().second);
+    ++numLowerBoundSends;
+  }
+
+  #ifndef NDEBUG
+    std::cout << "Controller sent lower bound " << lb << " to " << ranks.size() << " workers" << std::endl;
+  #endif
 }
 
 
@@ -356,29 +806,17 @@ inline bool CutAndSolveController::setIndiv(const std::size_t j, const bool val)
   if (val == 0)
   {
     if (individuals[j].inGrpOne())
-    {
-      for (std::size_t i = 0; i < data->numStates; ++i)
-      {
-        if (data->exprs[i][j])
-          markers[i].decrementNumGrpOneCarrying();
-      }
-    }
+      data->exprs.forEachState(j, [&](const std::size_t i) { markers[i].decrementNumGrpOneCarrying(); });
     else
-    {
-      for (std::size_t i = 0; i < data->numStates; ++i)
-      {
-        if (data->exprs[i][j])
-          markers[i].decrementNumGrpTwoCarrying();
-      }
-    }
+      data->exprs.forEachState(j, [&](const std::size_t i) { markers[i].decrementNumGrpTwoCarrying(); });
   }
   else
   {
-    for (std::size_t i = 0; i < data->numStates; ++i)
+    data->exprs.forEachMissingState(j, [&](const std::size_t i)
     {
-      if (!data->exprs[i][j] && !markers[i].isSet())
+      if (!markers[i].isSet())
         setMark(i, 0);
-    }
+    });
   }
 
   return true;
@@ -393,82 +831,45 @@ inline bool CutAndSolveController::setIndiv(const std::size_t j, const bool val)
 inline bool CutAndSolveController::setIndividualEqualityConstraints()
 {
   bool equalityWasSet = false;
-  std::vector<Individual> individuals_copy = individuals;
-  std::sort(std::begin(individuals_copy),
-            std::end(individuals_copy),
-            Individual::sortByNumRemainingMarkers);
-  std::vector<std::pair<std::size_t, std::size_t> > groups;
 
   // *
-  // * Find the start and end indexes for all groups of individuals that have
-  // * the same number of remaining markers
+  // * Mask of the marker states that haven't been set to zero
   // *
-  for (std::size_t i = 0; i < data->numIndiv - 1;)
+  std::vector<std::uint64_t> remainingStates(data->exprs.indivRowWords(), 0);
+  for (std::size_t i = 0; i < data->numStates; ++i)
   {
-    std::size_t j = i + 1;
-    while (j < data->numIndiv)
-    {
-      if (individuals_copy[i].getNumRemainingMarkers() != individuals_copy[j].getNumRemainingMarkers())
-      {
-        if (j-1 != i)
-          groups.emplace_back(std::make_pair(i, j-1));
-        break;
-      }
-      else if (j == data->numIndiv - 1)
-      {
-        groups.emplace_back(std::make_pair(i, j));
-      }
-      ++j;
-    }
-    i = j;
+    if (!markers[i].isZero())
+      StateMatrix::setBit(&remainingStates, i);
   }
 
+  // *
+  // * Make every individual equal to the first one with the same remaining
+  // * marker states
+  // *
+  std::vector<std::size_t> allIndividuals(data->numIndiv);
+  for (std::size_t j = 0; j < data->numIndiv; ++j)
+    allIndividuals[j] = j;
+
+  const std::vector<std::vector<std::size_t> > groups = data->exprs.groupSameStates(allIndividuals, remainingStates);
   for (auto it = std::begin(groups); it != std::end(groups); ++it)
   {
-    const std::size_t start = it->first;
-    const std::size_t end = it->second;
-
-    for (std::size_t index1 = start; index1 <= end - 1; ++index1)
+    const std::size_t x = it->front();
+    for (auto y = std::next(std::begin(*it)); y != std::end(*it); ++y)
     {
-      std::size_t x = individuals_copy[index1].getId();
-      for (std::size_t index2 = index1+1; index2 <= end; ++index2)
-      {
-        std::size_t y = individuals_copy[index2].getId();
-
-        // *
-        // * Check if there's already an equality constraint between
-        // * individuals x and y
-        // *
-        if (individualEqualities.exists(x, y))
-          continue;
-
-        // *
-        // * Check if individual x and y's remaining markers are equal
-        // *
-        {
-          std::size_t markNum = 0;
-          while (markNum < data->numStates && (markers[markNum].isZero()
-             ||  data->exprs[markNum][x] == data->exprs[markNum][y]))
-          {
-            ++markNum;
-          }
-
-          // *
-          // * If individual x and y's remaining markers are equal
-          // *
-          if (markNum == data->numStates)
-          {
-            individualEqualities.add(x, y);
-            rs.setIndivEquality(x, y);
-            equalityWasSet = true;
-
-            #ifndef NDEBUG
-              std::cout << "Forcing individual_" << x << " and individual_"
-                        << y << " to equal each other" << std::endl;
-            #endif
-          }
-        }
-      }
+      // *
+      // * Check if there's already an equality constraint between
+      // * individuals x and y
+      // *
+      if (!individualEqualities.add(x, *y))
+        continue;
+
+      rs.setIndivEquality(x, *y);
+      equalityWasSet = true;
+
+      #ifndef NDEBUG
+        std::cout << "Forcing individual_" << x << " and individual_"
+                  << *y << " to equal each other" << std::endl;
+      #endif
     }
   }
 
@@ -548,19 +949,11 @@ inline bool CutAndSolveController::setMark(const std::size_t i, const bool val)
   if (val == 0)
   {
     cutSet.keepMarkerInAllCuts(i);
-    for (std::size_t j = 0; j < data->numIndiv; ++j)
-    {
-      if (data->exprs[i][j])
-        individuals[j].decrementNumRemainingMarkers();
-    }
+    data->exprs.forEachCarrier(i, [&](const std::size_t j) { individuals[j].decrementNumRemainingMarkers(); });
   }
   else
   {
-    for (std::size_t j = 0; j < data->numIndiv; ++j)
-    {
-      if (!data->exprs[i][j])
-        setIndiv(j, 0);
-    }
+    data->exprs.forEachNonCarrier(i, [&](const std::size_t j) { setIndiv(j, 0); });
   }
 
   return true;
@@ -595,9 +988,27 @@ inline bool CutAndSolveController::setMarkersToZero()
 //------------------------------------------------------------------------------
 void CutAndSolveController::signalWorkersToEnd()
 {
+  // *
+  // * Problems still in the queue must be solved before the workers end
+  // *
+  while (!problemQueue.empty()) {
+    if (availableWorkers.empty())
+      receiveCompletion();
+    dispatchProblems();
+  }
+
   char signal = 0;
   for (std::size_t i = 1; i < world_size; ++i)
     MPI_Send(&signal, 1, MPI_CHAR, i, Parallel::CONVERGE_TAG, MPI_COMM_WORLD);
+
+  // *
+  // * Workers receive the lower bounds sent before the signal to end, and
+  // * none are sent after it
+  // *
+  endSignalled = true;
+  for (auto it = std::begin(lowerBoundSends); it != std::end(lowerBoundSends); ++it)
+    MPI_Wait(&it->second, MPI_STATUS_IGNORE);
+  lowerBoundSends.clear();
 }
 
 
@@ -606,7 +1017,7 @@ void CutAndSolveController::signalWorkersToEnd()
 //------------------------------------------------------------------------------
 bool CutAndSolveController::workersStillWorking() const
 {
-  return (availableWorkers.size() < (world_size - 1));
+  return (availableWorkers.size() < numSlots);
 }
 
 
@@ -634,6 +1045,111 @@ void CutAndSolveController::waitForWorkers()
 }
 
 
+//------------------------------------------------------------------------------
+// Starts from the results of an earlier run on the same data. The given
+// pattern (states of the data file, such as the best pattern in PATTERN_FILE,
+// or the heuristic's if it is better) raises the lower bound, and the cuts in
+// CUTS_FILE, whose sparse problems that run solved, are added to the cut set
+// and the relaxation.
+//
+// Patterns inside those cuts are not searched again, so the lower bound must
+// be at least as high as the best of them, or, when saving every pattern
+// above SOLUTION_POOL_THRESHOLD, that run's threshold must not have been
+// above this one. The cutfile's header records both, and the file is refused
+// if this run's would lose patterns.
+//------------------------------------------------------------------------------
+void CutAndSolveController::warmStart(const std::vector<std::size_t> &knownPattern)
+{
+  // *
+  // * The data file's states that were kept by the presolve
+  // *
+  const std::size_t numOriginalStates = data->numBins * data->numActualExprs;
+  std::vector<std::size_t> stateOf(numOriginalStates, data->numStates);
+  for (std::size_t i = 0; i < data->numStates; ++i)
+    stateOf[data->originalState[i]] = i;
+
+  if (!knownPattern.empty()) {
+    std::vector<std::size_t> pattern;
+    for (auto it = std::begin(knownPattern); it != std::end(knownPattern); ++it) {
+      assert(stateOf[*it] < data->numStates); // the presolve keeps the known pattern
+      pattern.push_back(stateOf[*it]);
+    }
+
+    const double objValue = CSFS::getObjectiveValue(data->exprs.countCarryingAll(pattern, data->grpOneStart, data->grpOneEnd),
+                                                    data->exprs.countCarryingAll(pattern, data->grpTwoStart, data->grpTwoEnd),
+                                                    data);
+    if (!data->QUIET)
+      std::cout << "Best known pattern:\n";
+    CSFS::printSolution(pattern, &logfile, data);
+
+    if (!data->USE_SOLUTION_POOL_THRESHOLD)
+      lb = std::max(lb, objValue);
+  }
+
+  if (!data->inputCutfileName.empty()) {
+    std::ifstream input(data->inputCutfileName.c_str());
+    if (!input.is_open())
+      throw std::runtime_error("Input cutfile could not be opened");
+
+    // *
+    // * Each line holds the data file's states of a cut. States the presolve
+    // * removed are left out, which leaves a smaller cut that was also solved.
+    // *
+    std::string line;
+    std::getline(input, line);
+    std::istringstream header(line);
+    std::string mode;
+    double threshold, cutfileLb;
+    if (line.compare(0, CUTFILE_HEADER.size(), CUTFILE_HEADER) != 0
+    ||  !(header.ignore(CUTFILE_HEADER.size()) >> mode >> threshold >> cutfileLb))
+      throw std::runtime_error("Input cutfile " + data->inputCutfileName + " has no csfs cutfile header.");
+
+    if (mode != (data->USE_SOLUTION_POOL_THRESHOLD ? "pool" : "best"))
+      throw std::runtime_error("Input cutfile was written with USE_SOLUTION_POOL_THRESHOLD "
+                               + std::string(mode == "pool" ? "true" : "false") + ", unlike this run.");
+    if (data->USE_SOLUTION_POOL_THRESHOLD && data->SOLUTION_POOL_THRESHOLD < threshold - data->TOL)
+      throw std::runtime_error("Input cutfile was written with SOLUTION_POOL_THRESHOLD " + std::to_string(threshold)
+                               + ", so the patterns between this run's threshold and it would be lost.");
+    if (!data->USE_SOLUTION_POOL_THRESHOLD && lb < cutfileLb - data->TOL)
+      throw std::runtime_error("Input cutfile was written with lower bound " + std::to_string(cutfileLb)
+                               + ", above this run's. Give that run's logfile as PATTERN_FILE.");
+
+    std::size_t numCutsRead = 0;
+    while (std::getline(input, line)) {
+      std::istringstream states(line);
+      Cut cut(data->numStates);
+      std::size_t state;
+      while (states >> state) {
+        if (state >= numOriginalStates)
+          throw std::runtime_error("Input cutfile holds state " + std::to_string(state)
+                                   + ", which is not in the data set.");
+        if (stateOf[state] < data->numStates)
+          cut.add(stateOf[state]);
+      }
+
+      if (cut.empty())
+        continue;
+
+      cutSet.add(cut);
+      rs.add(cut);
+      ++numCutsRead;
+    }
+
+    if (!data->QUIET)
+      std::cout << "Read " << numCutsRead << " solved cuts from " << data->inputCutfileName << std::endl;
+  }
+
+  if (setMarkersToZero()) {
+    setIndividualsToZero();
+    setIndividualEqualityConstraints();
+  }
+
+  if (!data->QUIET)
+    std::cout << "\nWarm start\n" << CSFS::getStringOfEndOfIterInfo(ub, lb, data->elapsed_cpu_time())
+              << "\n" << std::endl;
+}
+
+
 //------------------------------------------------------------------------------
 // The main function for cut and solve
 //------------------------------------------------------------------------------
@@ -664,6 +1180,13 @@ void CutAndSolveController::work() {
               << "   Iteration " << iter
               << "\n---------------------------\n";
 
+  const double prevLb = lb;
+
+  // *
+  // * Pick up any problems the workers finished since the last iteration
+  // *
+  pollCompletions();
+
 
   // *
   // * Get the next cut to solve
@@ -675,9 +1198,16 @@ void CutAndSolveController::work() {
   // *
   // * Solve a relaxation
   // *
+  Timer relaxationTimer(true);
   rs.solve();
+  relaxationTimer.stop();
   ub = std::min(ub, rs.getObjValue());
 
+  // *
+  // * Workers may have finished while the relaxation was being solved
+  // *
+  pollCompletions();
+
 
   // *
   // * Print the relaxation values
@@ -710,6 +1240,7 @@ void CutAndSolveController::work() {
   // *
   // * Create a cut to solve
   // *
+  Timer cutTimer(true);
   cut = cc.createCut(cutSet,
                      markers,
                      individuals,
@@ -717,6 +1248,7 @@ void CutAndSolveController::work() {
                      data->maxNumCuts(lb),
                      &cutCreatedFrom,
                      &indivCutWasBasedOn);
+  cutTimer.stop();
 
   if (!data->QUIET) {
     if (cutCreatedFrom == cc.RELAXATION)
@@ -728,10 +1260,26 @@ void CutAndSolveController::work() {
                 << "'s marker states" << std::endl;
   }
   
-  const double prevLb = lb;
+  if (telemetry.enabled()) {
+    telemetry.begin("iteration");
+    telemetry.add("iter", iter);
+    telemetry.add("relaxation_wall", relaxationTimer.elapsed_wall_time());
+    telemetry.add("relaxation_cpu", relaxationTimer.elapsed_cpu_time());
+    telemetry.add("cut_wall", cutTimer.elapsed_wall_time());
+    telemetry.add("cut_cpu", cutTimer.elapsed_cpu_time());
+    telemetry.add("cut_source", cutCreatedFrom == cc.RELAXATION ? "RELAXATION"
+                              : cutCreatedFrom == cc.MERGE ? "MERGE" : "INDIVIDUAL");
+    telemetry.add("cut_size", cut.size());
+    telemetry.add("num_cuts", cutSet.numCuts());
+    telemetry.add("lb", lb);
+    telemetry.add("ub", ub);
+    telemetry.add("queued", problemQueue.size());
+    telemetry.add("busy", unavailableWorkers.size());
+    telemetry.end();
+  }
 
   // *
-  // * Send sparse problems based on the cut to workers
+  // * Queue the sparse problem based on the cut for the workers
   // *
   sendProblems(cut);
 
@@ -747,13 +1295,7 @@ void CutAndSolveController::work() {
   // *
   if (cutCreatedFrom == cc.INDIVIDUAL) {
     setIndiv(indivCutWasBasedOn, 0);
-
-    if (individualEqualities.exists(indivCutWasBasedOn)) {
-      for (std::size_t j = 0; j < data->numIndiv; ++j) {
-        if (individualEqualities.exists(indivCutWasBasedOn, j))
-          setIndiv(j, 0);
-      }
-    }
+    individualEqualities.forEachEqual(indivCutWasBasedOn, [&](const std::size_t j) { setIndiv(j, 0); });
 
     individualWasSet = true;
   }
@@ -777,6 +1319,14 @@ void CutAndSolveController::work() {
 
   ++iter;
 
+  // *
+  // * Save the state of the search every CHECKPOINT_INTERVAL seconds
+  // *
+  if (data->CHECKPOINT_INTERVAL > 0 && checkpointTimer.elapsed_wall_time() >= data->CHECKPOINT_INTERVAL) {
+    writeCheckpoint();
+    checkpointTimer.restart();
+  }
+
   #ifndef NDEBUG
     std::cout << "Working workers: " << getStringOfUnavailableWorkers() << std::endl;
   #endif
@@ -784,4 +1334,146 @@ void CutAndSolveController::work() {
   if (!data->QUIET)
   std::cout << "\n" << CSFS::getStringOfEndOfIterInfo(ub, lb, data->elapsed_cpu_time())
             << "\n" << std::endl;
-}
\ No newline at end of file
+}
+
+
+//------------------------------------------------------------------------------
+// Writes the state of the search to the checkpoint file, so that a later run
+// can continue from it with --resume. The file holds:
+//   the magic bytes, the format version, the problem dimensions, the data
+//   file state of each state kept by presolve, the iteration, the bounds,
+//   the cuts, the fixed markers and individuals, the individual equalities,
+//   every sparse problem that has been created but not solved (queued, or
+//   sent to a worker that hasn't answered yet) with the split cut it is a
+//   part of, and the split cuts with parts left
+//
+// The file is written under a temporary name and then renamed, so a run
+// killed while writing it leaves the previous checkpoint intact.
+//------------------------------------------------------------------------------
+void CutAndSolveController::writeCheckpoint()
+{
+  MessageBuffer buffer;
+  buffer.put(CHECKPOINT_FORMAT_VERSION);
+  buffer.put(static_cast<std::uint64_t>(data->numStates));
+  buffer.put(static_cast<std::uint64_t>(data->numIndiv));
+  buffer.put(static_cast<std::uint64_t>(data->setSize));
+  buffer.put(static_cast<char>(data->RISK));
+  buffer.put(static_cast<char>(data->USE_SOLUTION_POOL_THRESHOLD));
+  for (std::size_t i = 0; i < data->numStates; ++i)
+    buffer.put(static_cast<std::uint64_t>(data->originalState[i]));
+
+  buffer.put(static_cast<std::uint64_t>(iter));
+  buffer.put(lb);
+  buffer.put(ub);
+  buffer.put(totalSparseTime);
+  buffer.put(static_cast<char>(cc.basesCutsOnIndividuals()));
+
+  buffer.put(static_cast<std::uint64_t>(cutSet.numCuts()));
+  for (auto it = cutSet.begin(); it != cutSet.end(); ++it)
+    buffer.putIndexSet(it->getTrueElements(), data->numStates);
+
+  {
+    std::vector<std::size_t> zero;
+    std::vector<std::size_t> one;
+    for (std::size_t i = 0; i < markers.size(); ++i) {
+      if (markers[i].isZero())
+        zero.push_back(i);
+      else if (markers[i].isOne())
+        one.push_back(i);
+    }
+    buffer.putIndexSet(zero, data->numStates);
+    buffer.putIndexSet(one, data->numStates);
+  }
+  {
+    std::vector<std::size_t> zero;
+    std::vector<std::size_t> one;
+    for (std::size_t j = 0; j < individuals.size(); ++j) {
+      if (individuals[j].isZero())
+        zero.push_back(j);
+      else if (individuals[j].isOne())
+        one.push_back(j);
+    }
+    buffer.putIndexSet(zero, data->numIndiv);
+    buffer.putIndexSet(one, data->numIndiv);
+  }
+
+  const std::vector<std::vector<std::size_t> > classes = individualEqualities.get2dVector();
+  buffer.put(static_cast<std::uint64_t>(classes.size()));
+  for (auto it = std::begin(classes); it != std::end(classes); ++it)
+    buffer.putIndexSet(*it, data->numIndiv);
+
+  buffer.put(static_cast<std::uint64_t>(unavailableWorkers.size() + problemQueue.size()));
+  for (auto it = std::begin(unavailableWorkers); it != std::end(unavailableWorkers); ++it) {
+    buffer.put(static_cast<std::uint64_t>(slotStats[*it].group));
+    buffer.put(static_cast<std::uint64_t>(sendBuffers[*it].size()));
+    buffer.putArray(sendBuffers[*it].data(), sendBuffers[*it].size());
+  }
+  for (std::size_t p = 0; p < problemQueue.size(); ++p) {
+    buffer.put(static_cast<std::uint64_t>(queuedStats[p].group));
+    buffer.put(static_cast<std::uint64_t>(problemQueue[p].size()));
+    buffer.putArray(problemQueue[p].data(), problemQueue[p].size());
+  }
+
+  buffer.put(static_cast<std::uint64_t>(splitGroups.size()));
+  for (auto it = std::begin(splitGroups); it != std::end(splitGroups); ++it) {
+    buffer.put(static_cast<std::uint64_t>(it->first));
+    buffer.put(static_cast<std::uint64_t>(it->second.numPartsLeft));
+    buffer.putIndexSet(it->second.cut, data->numStates);
+  }
+
+  // *
+  // * Write the file
+  // *
+  const std::string &filename = data->checkpointFileName;
+  const std::string tempFilename = filename + ".tmp";
+
+  FILE *output = fopen(tempFilename.c_str(), "wb");
+  if (output == NULL)
+    throw std::runtime_error("Could not open " + tempFilename + " for writing.");
+
+  bool ok = fwrite(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC), 1, output) == 1
+            && fwrite(buffer.data(), 1, buffer.size(), output) == buffer.size();
+  ok = (fclose(output) == 0) && ok;
+
+  if (!ok || std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+    throw std::runtime_error("Could not write " + filename + ".");
+
+  if (!data->QUIET)
+    std::cout << "Wrote checkpoint " << filename << std::endl;
+}
+
+
+//------------------------------------------------------------------------------
+// Writes (or rewrites) the first line of the output cutfile: the mode ("pool"
+// if USE_SOLUTION_POOL_THRESHOLD, otherwise "best"), SOLUTION_POOL_THRESHOLD
+// and the lower bound. warmStart() checks them before a later run uses the
+// cuts.
+//------------------------------------------------------------------------------
+void CutAndSolveController::writeCutfileHeader()
+{
+  std::ostringstream header;
+  header.precision(17);
+  header << CUTFILE_HEADER << " " << (data->USE_SOLUTION_POOL_THRESHOLD ? "pool" : "best")
+         << " " << data->SOLUTION_POOL_THRESHOLD << " " << lb;
+
+  const std::streampos end = cutfile.tellp();
+  cutfile.seekp(0);
+  cutfile << std::left << std::setw(CUTFILE_HEADER_WIDTH) << header.str() << std::right << "\n";
+  if (end > 0)
+    cutfile.seekp(end);
+}
+
+
+//------------------------------------------------------------------------------
+// Writes a solved cut to the output cutfile, as states of the data file on one
+// line, and records the current lower bound in the header. The file can be
+// given as CUTS_FILE to a later run.
+//------------------------------------------------------------------------------
+void CutAndSolveController::writeSolvedCut(const std::vector<std::size_t> &cut)
+{
+  for (auto it = std::begin(cut); it != std::end(cut); ++it)
+    cutfile << (it == std::begin(cut) ? "" : " ") << data->originalState[*it];
+  cutfile << "\n";
+  writeCutfileHeader();
+  cutfile.flush();
+}
@@ -3,16 +3,45 @@
 
 //#include <boost/multiprecision/cpp_dec_float.hpp>
 
+#include <deque>
+#include <list>
+#include <map>
+
 #include "CutCreator.h"
 #include "CSFS.h"
+#include "MappedFile.h"
+#include "MessageBuffer.h"
 #include "Parallel.h"
 #include "RelaxationSolver.h"
 #include "Solution.h"
+#include "Telemetry.h"
+#include "Timer.h"
 #include "VariableEqualities.h"
 
 class CutAndSolveController
 {
   private:
+    // When and from which iteration a sparse problem was created, for the
+    // telemetry records of its sending and solving
+    struct ProblemStats
+    {
+      std::size_t iter;
+      std::size_t cutSize;
+      double queuedAt;
+      double sentAt;
+      std::size_t group; // the split cut the problem is a part of, or NO_GROUP
+    };
+
+    // A cut split into disjoint parts, each solved as its own sparse problem.
+    // The cut is solved once every part has been.
+    struct SplitGroup
+    {
+      std::vector<std::size_t> cut;
+      std::size_t numPartsLeft;
+    };
+
+    static const std::size_t NO_GROUP;
+
     const CSFS_Data *data;
     CutCreator cc;
     RelaxationSolver rs;
@@ -24,8 +53,28 @@ class CutAndSolveController
     double lb;
     double ub;
 
-    std::stack<int> availableWorkers;
-    std::set<int> unavailableWorkers;
+    // Each worker rank solves up to WORKER_THREADS problems at once, one per
+    // slot. Slot s belongs to rank 1 + s % (world_size - 1).
+    std::size_t numSlots;
+    std::stack<int> availableWorkers;  // free slots
+    std::set<int> unavailableWorkers;  // busy slots
+
+    std::vector<MessageBuffer> sendBuffers; // indexed by slot
+    std::vector<MPI_Request> sendRequests;  // indexed by slot
+
+    static const std::size_t LB_POSITION = sizeof(uint32_t);                // byte offset of the lower bound in a packed problem
+    static const std::size_t SLOT_POSITION = LB_POSITION + sizeof(double);  // byte offset of the slot in a packed problem
+    static const std::size_t CUT_POSITION = SLOT_POSITION + sizeof(uint32_t); // byte offset of the cut in a packed problem
+    std::deque<MessageBuffer> problemQueue; // packed problems waiting for a free worker
+    std::deque<ProblemStats> queuedStats;   // parallel to problemQueue
+    std::vector<ProblemStats> slotStats;    // indexed by slot
+    std::map<std::size_t, SplitGroup> splitGroups;
+    std::size_t nextGroup;
+    std::size_t maxQueuedProblems;
+
+    std::list<std::pair<double, MPI_Request> > lowerBoundSends; // lower bounds being sent to workers
+    std::size_t numLowerBoundSends;
+    bool endSignalled;
 
     std::vector<Marker> markers;
     std::vector<Individual> individuals;
@@ -33,30 +82,49 @@ class CutAndSolveController
     VariableEqualities individualEqualities;
 
     std::ofstream logfile;
+    std::ofstream cutfile; // open if WRITE_CUTS_FILE
     
     double totalSparseTime;
+    std::size_t numProblemsSkipped; // sparse problems whose answer was known without solving them
     std::set<std::size_t> checkIn;
+
+    Timer checkpointTimer; // wall time since the last checkpoint
+    Telemetry telemetry;
         
+    bool answerIsKnown(const Cut &, bool *) const;
+    void dispatchProblems();
+    void packProblem(const Cut &, const std::vector<std::size_t> &, MessageBuffer *) const;
+    void pollCompletions();
+    void queueProblem(const Cut &, const std::vector<std::size_t> &, const std::size_t);
+    int rankOfSlot(const int) const;
     void receiveCompletion();
-    void sendProblem(const Cut &);
+    void sendProblem(MessageBuffer *);
     void sendProblems(Cut);
+    void shareLowerBound();
     bool setIndiv(const std::size_t, const bool);
     bool setIndividualEqualityConstraints();
     bool setIndividualsToZero();
     bool setIndividualsToZeroOrOne();
     bool setMark(const std::size_t, const bool);
     bool setMarkersToZero();
+    void writeCheckpoint();
+    void writeCutfileHeader();
+    void writeSolvedCut(const std::vector<std::size_t> &);
 
   public:
     CutAndSolveController(const CSFS_Data &);
     bool converged() const;
     double getLb() const;
     std::string getStringOfUnavailableWorkers() const;
+    double getTotalSparseTime() const;
     double getUb() const;
     std::size_t numWorkersWorking() const;
+    void recordSummary();
+    void resume(const std::string &);
     void signalWorkersToEnd();
     bool workersStillWorking() const;
     void waitForWorkers();
+    void warmStart(const std::vector<std::size_t> &);
     void work();
 
 };
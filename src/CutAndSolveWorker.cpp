@@ -1,17 +1,58 @@
 #include "CutAndSolveWorker.h"
 #include <cassert>
+#include <chrono>
+#include <limits>
+
+namespace
+{
+  // How long the main thread waits for a solver thread before checking for a
+  // message from the controller again
+  const std::chrono::milliseconds POLL_INTERVAL(10);
+}
 
 //------------------------------------------------------------------------------
 //    Constructor
 //------------------------------------------------------------------------------
 CutAndSolveWorker::CutAndSolveWorker(const CSFS_Data &_data) : data(&_data),
                                                             world_rank(Parallel::getWorldRank()),
-                                                            ss(_data),
-                                                            cutToSolve(data->numStates),
-                                                            lb(data->STARTING_LOWER_BOUND),
+                                                            numSolving(0),
+                                                            stopping(false),
+                                                            sharedLb(std::numeric_limits<double>::lowest()),
+                                                            endRequested(false),
                                                             end_(false)
 {
+  int provided;
+  MPI_Query_thread(&provided);
+  if (provided < MPI_THREAD_FUNNELED)
+    throw std::runtime_error("CutAndSolveWorker: The MPI library does not support MPI_THREAD_FUNNELED");
+
+  for (std::size_t t = 0; t < data->WORKER_THREADS; ++t)
+  {
+    solvers.emplace_back(new SparseSolver(_data));
+    if (data->SHARE_LOWER_BOUND)
+      solvers.back()->setSharedLowerBound(&sharedLb);
+  }
+  for (std::size_t t = 0; t < data->WORKER_THREADS; ++t)
+    threads.emplace_back(&CutAndSolveWorker::solverThread, this, t);
+}
+
+
+//------------------------------------------------------------------------------
+//    Destructor
+//------------------------------------------------------------------------------
+CutAndSolveWorker::~CutAndSolveWorker()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobReady.notify_all();
 
+  for (auto it = std::begin(threads); it != std::end(threads); ++it)
+  {
+    if (it->joinable())
+      it->join();
+  }
 }
 
 
@@ -25,180 +66,324 @@ bool CutAndSolveWorker::end() const
 
 
 //------------------------------------------------------------------------------
-// Receives the sparse problem to solve
+// Waits for the last solutions to be sent and stops the solver threads
 //------------------------------------------------------------------------------
-inline void CutAndSolveWorker::receiveProblem()
+inline void CutAndSolveWorker::finish()
 {
-  std::size_t numCuts;
-  std::vector<char> cutCharVec(data->numStates);
-  std::vector<char> temp(data->numStates);
-  MPI_Status status;
+  for (auto it = std::begin(pendingSends); it != std::end(pendingSends); ++it)
+    MPI_Wait(&it->second, MPI_STATUS_IGNORE);
+  pendingSends.clear();
 
-  // *
-  // * Check if received a signal to end
-  // *
-  MPI_Probe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-  if (status.MPI_TAG == Parallel::CONVERGE_TAG)
   {
-    char signal;
-    MPI_Recv(&signal, 1, MPI_CHAR, 0, Parallel::CONVERGE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    end_ = true;
-
-    #ifndef NDEBUG
-      std::cout << "Rank_" << world_rank << " received signal to end" << std::endl;
-    #endif
-
-    return;
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
   }
+  jobReady.notify_all();
 
-  // *
-  // * Receive the problem
-  // *
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " about to receive sparse problem" << std::endl;
-  #endif
+  for (auto it = std::begin(threads); it != std::end(threads); ++it)
+    it->join();
+  threads.clear();
 
-  MPI_Recv(&lb, 1, MPI_DOUBLE, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  end_ = true;
 
-  //ss.setThreshold(data->USE_SOLUTION_POOL_THRESHOLD? std::min(lb, data->SOLUTION_POOL_THRESHOLD): lb);
-  ss.setThreshold(lb);
-  //ss.setThreshold(0);
   #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " received lower bound of " << lb << std::endl;
+    std::cout << "Rank_" << world_rank << " finished all sparse problems and is ending" << std::endl;
   #endif
+}
 
-  MPI_Recv(&cutCharVec[0], cutCharVec.size(), MPI_CHAR, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-  cutToSolve.set(cutCharVec);
-  ss.setCutToSolve(cutToSolve);
-  
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " received the cut" << std::endl;
-  #endif
 
-  MPI_Recv(&numCuts, 1, CUSTOM_SIZE_T, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+//------------------------------------------------------------------------------
+// Unpacks a sparse problem into a solver and returns the slot it was sent to.
+// See CutAndSolveController::packProblem() for the layout.
+//------------------------------------------------------------------------------
+std::uint32_t CutAndSolveWorker::loadProblem(MessageBuffer *buffer, SparseSolver *ss) const
+{
+  const double lb = buffer->get<double>();
+  const std::uint32_t slot = buffer->get<std::uint32_t>();
 
+  //ss->setThreshold(data->USE_SOLUTION_POOL_THRESHOLD? std::min(lb, data->SOLUTION_POOL_THRESHOLD): lb);
+  ss->setThreshold(lb);
+  //ss->setThreshold(0);
   #ifndef NDEBUG
-    if (numCuts > 0)
-      std::cout << "Rank_" << world_rank << " about to receive the cut set" << std::endl;
+    std::cout << "Rank_" << world_rank << " slot " << slot << " received lower bound of " << lb << std::endl;
   #endif
 
-  for (std::size_t i = 0; i < numCuts; ++i)
+  Cut cutToSolve(data->numStates);
+  const std::vector<std::size_t> cutElements = buffer->getIndexSet(data->numStates);
+  for (std::size_t k = 0; k < cutElements.size(); ++k)
+    cutToSolve.add(cutElements[k]);
+  ss->setCutToSolve(cutToSolve);
+
+  const std::uint64_t numCuts = buffer->get<std::uint64_t>();
+  for (std::uint64_t c = 0; c < numCuts; ++c)
   {
-    MPI_Recv(&temp[0], temp.size(), MPI_CHAR, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    ss.addToCutSet(Cut(temp));
+    const std::vector<std::size_t> elements = buffer->getIndexSet(data->numStates);
+    Cut temp(data->numStates);
+    for (std::size_t k = 0; k < elements.size(); ++k)
+      temp.add(elements[k]);
+    ss->addToCutSet(temp);
   }
 
-  #ifndef NDEBUG
-    if (numCuts > 0)
-      std::cout << "Rank_" << world_rank << " received the cut set " << std::endl;
-  #endif
-
-  MPI_Recv(&temp[0], temp.size(), MPI_CHAR, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  // *
+  // * Markers and individuals not in either fixed set are free (2)
+  // *
+  std::vector<char> temp(data->numStates, 2);
+  std::vector<std::size_t> fixed = buffer->getIndexSet(data->numStates);
+  for (std::size_t k = 0; k < fixed.size(); ++k)
+    temp[fixed[k]] = 0;
+  fixed = buffer->getIndexSet(data->numStates);
+  for (std::size_t k = 0; k < fixed.size(); ++k)
+    temp[fixed[k]] = 1;
+  for (std::size_t i = 0; i < temp.size(); ++i)
+    ss->setMark(i, temp[i]);
+
+  temp.assign(data->numIndiv, 2);
+  fixed = buffer->getIndexSet(data->numIndiv);
+  for (std::size_t k = 0; k < fixed.size(); ++k)
+    temp[fixed[k]] = 0;
+  fixed = buffer->getIndexSet(data->numIndiv);
+  for (std::size_t k = 0; k < fixed.size(); ++k)
+    temp[fixed[k]] = 1;
+  for (std::size_t j = 0; j < temp.size(); ++j)
+    ss->setIndiv(j, temp[j]);
 
   #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " received the vector of markers" << std::endl;
+    std::cout << "Rank_" << world_rank << " slot " << slot << " unpacked " << buffer->size()
+              << " bytes (" << numCuts << " cuts)" << std::endl;
   #endif
 
-  for (std::size_t i = 0; i < temp.size(); ++i)
-  {
-    assert(temp[i] == 0 || temp[i] == 1 || temp[i]==2);
-    ss.setMark(i, temp[i]);
-    
-  }
+  return slot;
+}
 
-  temp.resize(data->numIndiv);
-  MPI_Recv(&temp[0], temp.size(), MPI_CHAR, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " received the vector of individuals\n"
-              << "Rank_" << world_rank << " received all info from controller" << std::endl;
-  #endif
+//------------------------------------------------------------------------------
+// Packs the solution to a sparse problem into a single message: format
+// version, slot, number of solutions, each solution's objective value and
+// marker states, the CPU and wall run time, the wall time the problem waited
+// for a solver thread, and the number of free markers and individuals left
+// after the solver's reductions
+//------------------------------------------------------------------------------
+void CutAndSolveWorker::packSolution(const std::uint32_t slot,
+                                     const double waitTime,
+                                     const SparseSolver &ss,
+                                     MessageBuffer *buffer) const
+{
+  const std::vector<Solution> solutionPool = ss.getSolutionPool();
+  const std::size_t numSol = solutionPool.size();
+  const double runTime = ss.getCpuTimeToSolve();
+  const double wallRunTime = ss.getWallTimeToSolve();
 
-  for (std::size_t i = 0; i < temp.size(); ++i)
+  buffer->clear();
+  buffer->putVersion();
+  buffer->put(slot);
+  buffer->put(static_cast<std::uint64_t>(numSol));
+  for (std::size_t i = 0; i < numSol; ++i)
   {
-    assert(temp[i] == 0 || temp[i] == 1 || temp[i] == 2);
-    ss.setIndiv(i, temp[i]);    
+    buffer->put(solutionPool[i].objValue);
+    for (std::size_t k = 0; k < data->setSize; ++k)
+      buffer->put(static_cast<std::uint32_t>(solutionPool[i].markerStates[k]));
   }
+  buffer->put(runTime);
+  buffer->put(wallRunTime);
+  buffer->put(waitTime);
+  buffer->put(static_cast<std::uint64_t>(ss.getNumFreeMarkers()));
+  buffer->put(static_cast<std::uint64_t>(ss.getNumFreeIndividuals()));
 }
 
 
 //------------------------------------------------------------------------------
-// Sends the solution to the sparse problem back to the controller
+// Receives the next message from the controller: a sparse problem, which is
+// queued for the solver threads, an improved lower bound, which the solver
+// threads pick up mid-solve, or the signal to end
 //------------------------------------------------------------------------------
-inline void CutAndSolveWorker::sendBackSolution()
+inline void CutAndSolveWorker::receiveMessage()
 {
+  MPI_Status status;
+
   // *
-  // * Get the data
+  // * Check if received a signal to end
   // *
-  const std::vector<Solution> solutionPool = ss.getSolutionPool();
-  const std::size_t numSol = solutionPool.size();    
-  const double runTime = ss.getCpuTimeToSolve();
+  MPI_Probe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+  if (status.MPI_TAG == Parallel::CONVERGE_TAG)
+  {
+    char signal;
+    MPI_Recv(&signal, 1, MPI_CHAR, 0, Parallel::CONVERGE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    endRequested = true;
+
+    #ifndef NDEBUG
+      std::cout << "Rank_" << world_rank << " received signal to end" << std::endl;
+    #endif
+
+    return;
+  }
+
+  if (status.MPI_TAG == Parallel::LOWER_BOUND_TAG)
+  {
+    double lb;
+    MPI_Recv(&lb, 1, MPI_DOUBLE, 0, Parallel::LOWER_BOUND_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    if (lb > sharedLb.load())
+      sharedLb.store(lb); // only this thread writes it
+
+    #ifndef NDEBUG
+      std::cout << "Rank_" << world_rank << " received lower bound of " << lb << std::endl;
+    #endif
+
+    return;
+  }
 
   // *
-  // * Send back the data
+  // * Receive the problem
   // *
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " about to send back sparse problem" << std::endl;
-  #endif
+  MessageBuffer buffer;
+  buffer.receive(0, Parallel::SPARSE_TAG, &status);
+  buffer.checkVersion();
 
   #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " about to send back " << numSol << " solution vectors" << std::endl;
+    std::cout << "Rank_" << world_rank << " received a sparse problem" << std::endl;
   #endif
-  
-  MPI_Send(&numSol, 1, CUSTOM_SIZE_T, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
-  
-  for (std::size_t i = 0; i < numSol; ++i)
+
   {
-    MPI_Send(&solutionPool[i].objValue, 1, MPI_DOUBLE, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.emplace_back(std::move(buffer), data->elapsed_wall_time());
+  }
+  jobReady.notify_one();
+}
+
+
+//------------------------------------------------------------------------------
+// Sends the solutions left by the solver threads back to the controller, and
+// releases the buffers of sends that have completed
+//------------------------------------------------------------------------------
+inline void CutAndSolveWorker::sendResults()
+{
+  std::deque<MessageBuffer> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ready.swap(results);
+  }
+
+  for (auto it = std::begin(ready); it != std::end(ready); ++it)
+  {
+    pendingSends.emplace_back(std::move(*it), MPI_REQUEST_NULL);
+    pendingSends.back().first.isend(0, Parallel::SPARSE_TAG, &pendingSends.back().second);
 
     #ifndef NDEBUG
-      std::cout << "Rank_" << world_rank << " sent back objective value of " << solutionPool[i].objValue << std::endl;
+      std::cout << "Rank_" << world_rank << " sent back a solution ("
+                << pendingSends.back().first.size() << " bytes) to the controller" << std::endl;
     #endif
+  }
 
-    MPI_Send(&solutionPool[i].markerStates[0], data->setSize, CUSTOM_SIZE_T, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
+  for (auto it = std::begin(pendingSends); it != std::end(pendingSends);)
+  {
+    int done = 0;
+    MPI_Test(&it->second, &done, MPI_STATUS_IGNORE);
+    if (done)
+      it = pendingSends.erase(it);
+    else
+      ++it;
   }
-  
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " sent back the solution vectors" << std::endl;
-  #endif
+}
 
-  MPI_Send(&runTime, 1, MPI_DOUBLE, 0, Parallel::SPARSE_TAG, MPI_COMM_WORLD);
 
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " sent back the run time" << std::endl;
-    std::cout << "Rank_" << world_rank << " sent back all info to the controller" << std::endl;
-  #endif
+//------------------------------------------------------------------------------
+// Body of a solver thread: takes problems off the job queue, solves them with
+// the thread's own SparseSolver, and puts the packed solutions on the result
+// queue. Makes no MPI calls.
+//------------------------------------------------------------------------------
+void CutAndSolveWorker::solverThread(const std::size_t t)
+{
+  SparseSolver &ss = *solvers[t];
+
+  try
+  {
+    while (true)
+    {
+      MessageBuffer job;
+      double waitTime;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (jobs.empty())
+          return;
+
+        job = std::move(jobs.front().first);
+        waitTime = data->elapsed_wall_time() - jobs.front().second;
+        jobs.pop_front();
+        ++numSolving;
+      }
+
+      const std::uint32_t slot = loadProblem(&job, &ss);
+      ss.solve();
+
+      MessageBuffer result;
+      packSolution(slot, waitTime, ss, &result);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(std::move(result));
+        --numSolving;
+      }
+      resultReady.notify_one();
+    }
+  }
+  catch (...)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error)
+        error = std::current_exception();
+    }
+    resultReady.notify_one();
+  }
 }
 
 
 //------------------------------------------------------------------------------
-// Receives a problem (or a signal to end), solves the sparse problem, and sends
-// back the solution
+// One step of the worker's loop: sends back finished solutions, then either
+// receives the next message from the controller or waits up to POLL_INTERVAL
+// for a solver thread to finish. Blocks on the controller only when no problem
+// is being solved.
+//
+// The loop has to poll while problems are being solved: only this thread
+// makes MPI calls, so it can't block in MPI_Probe without missing finished
+// results, and a solver thread can't wake it from one. A finished result ends
+// the wait at once, so only messages from the controller wait for the poll.
 //------------------------------------------------------------------------------
 void CutAndSolveWorker::work()
 {
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " about to receive sparse problem" << std::endl;
-  #endif
-
-  receiveProblem();
-  if (end_)
-    return;
+  sendResults();
 
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " about to solve sparse problem" << std::endl;
-  #endif
+  bool idle;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error)
+      std::rethrow_exception(error);
+    idle = jobs.empty() && results.empty() && numSolving == 0;
+  }
 
-  ss.solve();
+  if (idle && endRequested)
+  {
+    finish();
+    return;
+  }
 
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " finished sparse problem and about to send back solution" << std::endl;
-  #endif
+  if (idle)
+  {
+    receiveMessage();
+    return;
+  }
 
-  sendBackSolution();
+  if (!endRequested)
+  {
+    int arrived = 0;
+    MPI_Iprobe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &arrived, MPI_STATUS_IGNORE);
+    if (arrived)
+    {
+      receiveMessage();
+      return;
+    }
+  }
 
-  #ifndef NDEBUG
-    std::cout << "Rank_" << world_rank << " sent back solution" << std::endl;
-  #endif
+  std::unique_lock<std::mutex> lock(mutex);
+  resultReady.wait_for(lock, POLL_INTERVAL, [this] { return !results.empty() || error; });
 }
-
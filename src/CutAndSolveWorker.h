@@ -1,29 +1,61 @@
 #ifndef CNS_WORKER_H
 #define CNS_WORKER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "MessageBuffer.h"
 #include "Parallel.h"
 #include "SparseSolver.h"
 
+// *
+// * A worker rank runs WORKER_THREADS solver threads, each with its own
+// * SparseSolver, that share the rank's read-only CSFS_Data. Only the rank's
+// * main thread makes MPI calls: it receives problems into the job queue and
+// * sends back the solutions the solver threads leave in the result queue.
+// *
 class CutAndSolveWorker
 {
   private:
     const CSFS_Data *data;
     std::size_t world_rank;
-    SparseSolver ss;
 
-    Cut cutToSolve;
+    std::vector<std::unique_ptr<SparseSolver> > solvers; // one per solver thread
+    std::vector<std::thread> threads;
 
-    double lb;
+    std::mutex mutex;                    // guards everything below up to end_
+    std::condition_variable jobReady;
+    std::condition_variable resultReady;
+    std::deque<std::pair<MessageBuffer, double> > jobs; // received problems waiting for a solver thread, and when they arrived
+    std::deque<MessageBuffer> results;   // packed solutions waiting to be sent
+    std::size_t numSolving;
+    bool stopping;
+    std::exception_ptr error;            // first exception thrown by a solver thread
+
+    std::atomic<double> sharedLb;        // best lower bound sent by the controller, read by the solver threads mid-solve
+
+    std::list<std::pair<MessageBuffer, MPI_Request> > pendingSends;
+    bool endRequested;
     bool end_;
 
-    void receiveProblem();
-    void sendBackSolution();
+    void finish();
+    std::uint32_t loadProblem(MessageBuffer *, SparseSolver *) const;
+    void packSolution(const std::uint32_t, const double, const SparseSolver &, MessageBuffer *) const;
+    void receiveMessage();
+    void sendResults();
+    void solverThread(const std::size_t);
 
   public:
     CutAndSolveWorker(const CSFS_Data &);
+    ~CutAndSolveWorker();
     bool end() const;
     void work();
 };
 
 #endif
-
@@ -4,7 +4,8 @@
 //------------------------------------------------------------------------------
 //    Constructor
 //------------------------------------------------------------------------------
-CutCreator::CutCreator(const CSFS_Data &_data) : data(&_data)
+CutCreator::CutCreator(const CSFS_Data &_data) : data(&_data),
+                                                 useIndivs(false)
 {}
 
 
@@ -21,7 +22,6 @@ Cut CutCreator::createCut(const CutSet &cutSet,
                           int *cutCreatedFrom,
                           std::size_t *indivCutWasBasedOn)
 {
-  static bool useIndivs = false;
   Cut cut(data->numStates);
   *indivCutWasBasedOn = data->numIndiv; // initially set to an invalid individual
 
@@ -55,6 +55,15 @@ Cut CutCreator::createCut(const CutSet &cutSet,
 }
 
 
+//------------------------------------------------------------------------------
+// Returns true if cuts are being based on individuals
+//------------------------------------------------------------------------------
+bool CutCreator::basesCutsOnIndividuals() const
+{
+  return useIndivs;
+}
+
+
 //------------------------------------------------------------------------------
 // Creates and returns a cut based on an individual. Also returns be reference
 // the number of the individual the cut was based on.
@@ -83,11 +92,11 @@ inline Cut CutCreator::createCutFromIndividuals(const std::vector<Marker> &marke
 
   assert(ind != data->numIndiv);
 
-  for (std::size_t i = 0; i < data->numStates; ++i)
+  data->exprs.forEachState(ind, [&](const std::size_t i)
   {
-    if (data->exprs[i][ind] && !markers[i].isZero())
+    if (!markers[i].isZero())
       cut.add(i);
-  }
+  });
 
   *indivCutWasBasedOn = ind;
   return cut;
@@ -204,3 +213,12 @@ inline bool CutCreator::switchToIndivs(const CutSet &cutSet,
   return false;
 }
 
+
+//------------------------------------------------------------------------------
+// Sets whether cuts are based on individuals. Used when resuming from a
+// checkpoint.
+//------------------------------------------------------------------------------
+void CutCreator::setBasesCutsOnIndividuals(const bool val)
+{
+  useIndivs = val;
+}
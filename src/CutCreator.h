@@ -10,6 +10,7 @@ class CutCreator
 {
   private:
     const CSFS_Data *data;
+    bool useIndivs; // once true, every cut is based on an individual
 
     Cut createCutFromIndividuals(const std::vector<Marker> &,
                                  const std::vector<Individual> &,
@@ -29,6 +30,7 @@ class CutCreator
     const int INDIVIDUAL = 3;
 
     CutCreator(const CSFS_Data &);
+    bool basesCutsOnIndividuals() const;
     Cut createCut(const CutSet &,
                   const std::vector<Marker> &,
                   const std::vector<Individual> &,
@@ -36,6 +38,7 @@ class CutCreator
                   const std::size_t,
                   int *,
                   std::size_t *);
+    void setBasesCutsOnIndividuals(const bool);
 };
 
 #endif
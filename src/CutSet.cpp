@@ -1,11 +1,18 @@
 #include "CutSet.h"
+#include <algorithm>
 #include <cassert>
+#include <limits>
+
+const std::size_t CutSet::NO_CUT = std::numeric_limits<std::size_t>::max();
 
 //------------------------------------------------------------------------------
 //    Constructor
 //------------------------------------------------------------------------------
 CutSet::CutSet(const std::size_t _numElementsPerCut) : maxSize_(0),
-                                                       numElementsPerCut(_numElementsPerCut)
+                                                       numElementsPerCut(_numElementsPerCut),
+                                                       cutsWithState(_numElementsPerCut),
+                                                       numCutsWithState(_numElementsPerCut, 0),
+                                                       nearestKept(false)
 {}
 
 
@@ -33,20 +40,8 @@ bool CutSet::add(Cut cut)
   // *
   // * Check if the given cut is a subset of any other cut in the set
   // *
-  for (auto it = cuts.rbegin(); it != cuts.rend(); ++it)
-  {
-    if (cut.size() > it->size())
-      break; // break because cuts are in order from largest to smallest
-
-    for (std::size_t i = 0; i < numElementsPerCut; ++i)
-    {
-      if (cut[i] && !(*it)[i]) //!it->inCut(i)
-        goto NEXT_CUT_A;
-    }
+  if (isWithinStoredCut(cut.getTrueElements(), cut.size()))
     return false;
-    NEXT_CUT_A:
-    ;
-  }
 
   // *
   // * Add markers in markersInAllCuts
@@ -55,90 +50,95 @@ bool CutSet::add(Cut cut)
     cut.add(*it);
 
   // *
-  // * Check if any cut in the set is a subset of the given cut
+  // * Erase the cuts in the set that are subsets of the given cut
   // *
-  {
-    auto it = std::begin(cuts);
-    while (it != std::end(cuts))
-    {
-      bool advance = true;
-      if (it->size() >= cut.size())
-        break; // break because cuts are in order from smallest to largest
-      for (std::size_t i = 0; i < numElementsPerCut; ++i)
-      {
-        if ((*it)[i] && !cut[i])
-          goto NEXT_CUT_B;
-      }
-
-      // *it is a subset of the given cut
-      if (it != std::begin(cuts))
-      {
-        const auto prev = std::prev(it);
-        cuts.erase(it);
-        it = prev;
-      }
-      else
-      {
-        cuts.erase(it);
-        it = std::begin(cuts);
-        advance = false;
-      }
-
-      NEXT_CUT_B:
-      if (advance)
-        ++it;
-    }
-  }
+  const std::vector<std::size_t> subsets = storedSubsetsOf(cut);
+  for (auto it = std::begin(subsets); it != std::end(subsets); ++it)
+    eraseCut(*it);
 
-  cuts.insert(cut); // Add the cut to the set
   maxSize_ = std::max(maxSize_, cut.size()); // update maxSize_
+  insertCut(std::move(cut)); // Add the cut to the set
   return true;
 }
 
 
 //------------------------------------------------------------------------------
-// Returns true if the given cut already exists in some form in the set
+// Returns an iterator to the first cut in the set
 //------------------------------------------------------------------------------
-bool CutSet::exists(const Cut &cut) const
+CutSet::const_iterator CutSet::begin() const
 {
-  for (auto it = cuts.rbegin(); it != cuts.rend() && cut.size() <= it->size(); ++it)
-  {
-    for (std::size_t i = 0; i < numElementsPerCut; ++i)
-    {
-      if (cut[i] && !(*it)[i])
-        goto NEXT_CUT;
-    }
+  return cuts.begin();
+}
 
-    return true;
 
-    NEXT_CUT:
-    ;
-  }
+//------------------------------------------------------------------------------
+// Returns true if the given cut is itself stored in the set
+//------------------------------------------------------------------------------
+bool CutSet::contains(const Cut &cut) const
+{
+  return cuts.count(cut) != 0;
+}
 
-  return false;
+
+//------------------------------------------------------------------------------
+// Returns an iterator past the last cut in the set
+//------------------------------------------------------------------------------
+CutSet::const_iterator CutSet::end() const
+{
+  return cuts.end();
 }
 
 
 //------------------------------------------------------------------------------
-// Returns true if the given cut already exists in some form in the set
+// Erases the cut with the given id from the set and the index
 //------------------------------------------------------------------------------
-bool CutSet::exists(const std::vector<std::size_t> &vec) const
+void CutSet::eraseCut(const std::size_t id)
 {
-  for (auto it = cuts.rbegin(); it != cuts.rend(); ++it)
+  const std::vector<std::size_t> &elements = cutById[id]->getTrueElements();
+  const std::uint64_t bit = std::uint64_t(1) << (id & 63);
+  for (auto it = std::begin(elements); it != std::end(elements); ++it)
+  {
+    cutsWithState[*it][id >> 6] &= ~bit;
+    --numCutsWithState[*it];
+  }
+
+  liveIds[id >> 6] &= ~bit;
+  cuts.erase(cutById[id]);
+  freeIds.push_back(id);
+
+  // *
+  // * The cuts this was nearest to keep its distance as a bound
+  // *
+  if (nearestKept)
   {
-    for (std::size_t i = 0; i < vec.size(); ++i)
+    for (std::size_t w = 0; w < liveIds.size(); ++w)
     {
-      if ( !((*it)[vec[i]]) )
-        goto NEXT_CUT;
+      for (std::uint64_t word = liveIds[w]; word; word &= word - 1)
+      {
+        const std::size_t other = (w << 6) + __builtin_ctzll(word);
+        if (nearestId[other] == id)
+          nearestStale[other] = 1;
+      }
     }
+  }
+}
 
-    return true;
 
-    NEXT_CUT:
-    ;
-  }
+//------------------------------------------------------------------------------
+// Returns true if the given cut already exists in some form in the set
+//------------------------------------------------------------------------------
+bool CutSet::exists(const Cut &cut) const
+{
+  return isWithinStoredCut(cut.getTrueElements(), cut.size());
+}
 
-  return false;
+
+//------------------------------------------------------------------------------
+// Returns true if the given cut already exists in some form in the set
+//------------------------------------------------------------------------------
+bool CutSet::exists(const std::vector<std::size_t> &vec) const
+{
+  return isWithinStoredCut(vec, 0);
 }
 
 
@@ -154,9 +154,7 @@ std::vector<std::vector<char> > CutSet::get2dCharVector() const
 
   for (std::size_t i = 0; i < cuts.size(); ++i, ++it)
   {
-    vec[i].resize(numElementsPerCut);
-    for (std::size_t j = 0; j < numElementsPerCut; ++j)
-      vec[i][j] = (*it)[j];
+    vec[i] = it->getCharVector();
   }
 
   return vec;
@@ -173,138 +171,393 @@ std::set<std::size_t> CutSet::getMarkersKeptInAllCuts() const
 
 
 //------------------------------------------------------------------------------
-// Finds the smallest cut and its closest cut and returns their merged cut.
+// Finds the smallest cut and its closest cut and returns their merged cut. Of
+// equally close pairs, the one whose other cut is smaller is merged.
 //------------------------------------------------------------------------------
 Cut CutSet::getMergedCutContainingSmallest() const
 {
   assert(cuts.size() >= 2);
 
-  std::vector<Cut> smallestCuts; // Stores the smallest cuts in the cut set.
-                                 // This will only contain a single cut if there
-                                 // is only one cut in the set with the fewest
-                                 // number of marker states.
+  const std::size_t id = nearestPairAmong(cuts.begin()->size());
+  Cut mergedCut(*cutById[id]);
+  mergedCut.unite(*cutById[nearestId[id]]);
+  return mergedCut;
+}
+
 
-  // *
-  // * Find the smallest cuts
-  // *
+//------------------------------------------------------------------------------
+// Finds the two closest cuts and returns the merged cut. Of equally close
+// pairs, the one with the smaller difference in size is merged.
+//------------------------------------------------------------------------------
+Cut CutSet::getMergedCutOfClosestPair() const
+{
+  assert(cuts.size() >= 2);
+
+  const std::size_t id = nearestPairAmong(numElementsPerCut);
+  Cut mergedCut(*cutById[id]);
+  mergedCut.unite(*cutById[nearestId[id]]);
+  return mergedCut;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns a copy of the original std::set<Cut>
+//------------------------------------------------------------------------------
+std::set<Cut> CutSet::getRawSet() const
+{
+  return cuts;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of words in a bitset over cut ids
+//------------------------------------------------------------------------------
+inline std::size_t CutSet::idWords() const
+{
+  return liveIds.size();
+}
+
+
+//------------------------------------------------------------------------------
+// Records in the index that the cut with the given id contains the given state
+//------------------------------------------------------------------------------
+inline void CutSet::indexState(const std::size_t state, const std::size_t id)
+{
+  std::vector<std::uint64_t> &row = cutsWithState[state];
+  if (row.size() < idWords())
+    row.resize(idWords(), 0);
+
+  row[id >> 6] |= std::uint64_t(1) << (id & 63);
+  ++numCutsWithState[state];
+}
+
+
+//------------------------------------------------------------------------------
+// Puts the cut in the set and the index without any subset checks, and
+// returns its id. Ids of erased cuts are reused.
+//------------------------------------------------------------------------------
+std::size_t CutSet::insertCut(Cut cut)
+{
+  std::size_t id;
+  if (freeIds.empty())
+  {
+    id = cutById.size();
+    cutById.push_back(std::end(cuts));
+    nearestId.push_back(NO_CUT);
+    nearestDistance.push_back(0);
+    nearestSizeDiff.push_back(0);
+    nearestStale.push_back(0);
+    if (id >> 6 >= liveIds.size())
+      liveIds.resize(std::max(std::size_t(1), 2 * liveIds.size()), 0);
+  }
+  else
   {
-    std::size_t smallestSize = 0;
-    auto it = std::begin(cuts);
+    id = freeIds.back();
+    freeIds.pop_back();
+  }
 
-    smallestCuts.push_back(*it);
-    smallestSize = it->size();
-    ++it;
+  cutById[id] = cuts.insert(std::move(cut)).first;
+  liveIds[id >> 6] |= std::uint64_t(1) << (id & 63);
 
-    for (; it != std::end(cuts); ++it)
-    {
-      assert(it->size() >= smallestSize);
+  const std::vector<std::size_t> &elements = cutById[id]->getTrueElements();
+  for (auto it = std::begin(elements); it != std::end(elements); ++it)
+    indexState(*it, id);
 
-      if (it->size() == smallestSize)
-        smallestCuts.push_back(*it);
-      else
-        break;
+  if (nearestKept)
+    scanNearest(id, true);
+
+  return id;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns true if the pair of cuts a1 and a2, distA apart, is closer than the
+// pair b1 and b2, distB apart. Ties go to the smaller difference in size, then
+// to the pair that comes first in the order of the set.
+//------------------------------------------------------------------------------
+bool CutSet::isCloserPair(const std::size_t a1, const std::size_t a2, const std::size_t distA,
+                          const std::size_t b1, const std::size_t b2, const std::size_t distB) const
+{
+  if (distA != distB)
+    return distA < distB;
+
+  const Cut *firstA = &*cutById[a1];
+  const Cut *secondA = &*cutById[a2];
+  const Cut *firstB = &*cutById[b1];
+  const Cut *secondB = &*cutById[b2];
+
+  const std::size_t sizeDiffA = absoluteDifference(firstA->size(), secondA->size());
+  const std::size_t sizeDiffB = absoluteDifference(firstB->size(), secondB->size());
+  if (sizeDiffA != sizeDiffB)
+    return sizeDiffA < sizeDiffB;
+
+  if (*secondA < *firstA)
+    std::swap(firstA, secondA);
+  if (*secondB < *firstB)
+    std::swap(firstB, secondB);
+
+  if (*firstA < *firstB)
+    return true;
+  if (*firstB < *firstA)
+    return false;
+  return *secondA < *secondB;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns true if some cut in the set holds every one of the given states and
+// at least minSize states
+//------------------------------------------------------------------------------
+bool CutSet::isWithinStoredCut(const std::vector<std::size_t> &states, const std::size_t minSize) const
+{
+  if (cuts.empty() || cuts.rbegin()->size() < minSize)
+    return false;
+
+  std::vector<std::uint64_t> candidates(liveIds);
+  for (auto it = std::begin(states); it != std::end(states); ++it)
+  {
+    const std::vector<std::uint64_t> &row = cutsWithState[*it];
+    bool any = false;
+    for (std::size_t w = 0; w < candidates.size(); ++w)
+    {
+      candidates[w] &= (w < row.size() ? row[w] : 0);
+      any = any || candidates[w];
     }
+    if (!any)
+      return false;
   }
 
+  for (std::size_t w = 0; w < candidates.size(); ++w)
+  {
+    std::uint64_t word = candidates[w];
+    while (word)
+    {
+      if (cutById[(w << 6) + __builtin_ctzll(word)]->size() >= minSize)
+        return true;
+      word &= word - 1;
+    }
+  }
 
-  // *
-  // * Find the two cuts that have the smallest distance between them, where
-  // * at least one of these cuts must be part of the smallestCuts vector
-  // *
-  auto it = std::begin(cuts);
-  Cut cut1 = smallestCuts[0];
-
-  while (!it->distance(cut1))
-    ++it;
+  return false;
+}
 
-  Cut cut2 = *it;
-  ++it;
 
-  std::size_t shortestDistance = cut1.distance(cut2);
+//------------------------------------------------------------------------------
+// Returns the id of the cut, of those with at most maxSize states, that is
+// part of the closest pair. Stale cuts whose bound could beat the closest
+// known pair are scanned again until the closest pair is exact.
+//------------------------------------------------------------------------------
+std::size_t CutSet::nearestPairAmong(const std::size_t maxSize) const
+{
+  keepNearest();
 
-  for (std::size_t i = 0; i < smallestCuts.size(); ++i)
+  for (;;)
   {
-    for (; it != std::end(cuts); ++it)
+    // *
+    // * Find the closest distance and difference in size, preferring a stale
+    // * cut whose bound reaches it
+    // *
+    std::size_t best = NO_CUT;
+    for (std::size_t w = 0; w < liveIds.size(); ++w)
     {
-      const std::size_t distance = it->distance(smallestCuts[i]);
-      if (distance == 0)
+      for (std::uint64_t word = liveIds[w]; word; word &= word - 1)
       {
-        continue;
+        const std::size_t id = (w << 6) + __builtin_ctzll(word);
+        if (cutById[id]->size() > maxSize || (!nearestStale[id] && nearestId[id] == NO_CUT))
+          continue;
+
+        if (best == NO_CUT
+        ||  nearestDistance[id] < nearestDistance[best]
+        ||  (nearestDistance[id] == nearestDistance[best]
+        &&   (nearestSizeDiff[id] < nearestSizeDiff[best]
+        ||    (nearestSizeDiff[id] == nearestSizeDiff[best] && nearestStale[id] && !nearestStale[best]))))
+          best = id;
       }
-      else if (distance < shortestDistance)
-      {
-        cut1 = smallestCuts[i];
-        cut2 = *it;
-        shortestDistance = distance;
-      }
-      else if (distance == shortestDistance && it->size() < cut2.size())
+    }
+
+    assert(best != NO_CUT);
+    if (nearestStale[best])
+    {
+      scanNearest(best, false);
+      continue;
+    }
+
+    // *
+    // * All pairs this close are exact, so break the ties by order
+    // *
+    for (std::size_t w = 0; w < liveIds.size(); ++w)
+    {
+      for (std::uint64_t word = liveIds[w]; word; word &= word - 1)
       {
-        cut2 = *it;
+        const std::size_t id = (w << 6) + __builtin_ctzll(word);
+        if (cutById[id]->size() <= maxSize
+        &&  nearestId[id] != NO_CUT
+        &&  nearestDistance[id] == nearestDistance[best]
+        &&  nearestSizeDiff[id] == nearestSizeDiff[best]
+        &&  id != best
+        &&  isCloserPair(id, nearestId[id], nearestDistance[id],
+                         best, nearestId[best], nearestDistance[best]))
+          best = id;
       }
     }
+
+    return best;
   }
+}
 
-  // *
-  // * Create the merged cut
-  // *
-  Cut mergedCut(numElementsPerCut);
-  for (std::size_t i = 0; i < numElementsPerCut; ++i)
+
+//------------------------------------------------------------------------------
+// Offers other, the given distance away, as the nearest cut of id. It is kept
+// if the pair is closer than the stored one, which for a stale id is only a
+// bound on its distance and difference in size.
+//------------------------------------------------------------------------------
+inline void CutSet::offerNearest(const std::size_t id, const std::size_t other,
+                                 const std::size_t distance) const
+{
+  const std::size_t sizeDiff = absoluteDifference(cutById[id]->size(), cutById[other]->size());
+  const bool closer = nearestStale[id]
+                    ? (distance < nearestDistance[id]
+                    || (distance == nearestDistance[id] && sizeDiff < nearestSizeDiff[id]))
+                    : (nearestId[id] == NO_CUT
+                    || isCloserPair(id, other, distance, id, nearestId[id], nearestDistance[id]));
+  if (closer)
   {
-    if (cut1[i] || cut2[i])
-      mergedCut.add(i);
+    nearestId[id] = other;
+    nearestDistance[id] = distance;
+    nearestSizeDiff[id] = sizeDiff;
   }
-  return mergedCut;
 }
 
 
 //------------------------------------------------------------------------------
-// Finds the two closest cuts and returns the merged cut.
+// Brings the nearest cuts up to date after the cuts with the given ids had a
+// marker added that the other cuts already held. Pairs on the same side keep
+// their distance and order, so only pairs across the sides are compared. A
+// cut whose nearest cut was across the sides, or erased, becomes stale.
 //------------------------------------------------------------------------------
-Cut CutSet::getMergedCutOfClosestPair() const
+void CutSet::refreshNearestAcross(const std::vector<std::size_t> &changed) const
 {
-  assert(cuts.size() >= 2);
+  std::vector<char> side(cutById.size(), 0);
+  for (auto it = std::begin(changed); it != std::end(changed); ++it)
+    side[*it] = 1;
 
-  auto it = std::begin(cuts);
-  auto it2 = std::next(it, 1);
-  std::size_t distance = it->distance(*it2);
-  Cut cut1 = *it;
-  Cut cut2 = *it2;
-  std::size_t sizeDiff = absoluteDifference(cut1.size(), cut2.size());
-
-  std::advance(it2, 1);
-  for (; it != std::end(cuts); ++it)
+  std::vector<std::size_t> liveChanged;
+  std::vector<std::size_t> liveUnchanged;
+  for (std::size_t w = 0; w < liveIds.size(); ++w)
   {
-    for (; it2 != std::end(cuts); ++it2)
+    for (std::uint64_t word = liveIds[w]; word; word &= word - 1)
     {
-      const std::size_t temp = it->distance(*it2);
+      const std::size_t id = (w << 6) + __builtin_ctzll(word);
+      const std::size_t nearest = nearestId[id];
+      if (!nearestStale[id] && nearest != NO_CUT
+      &&  (!(liveIds[nearest >> 6] >> (nearest & 63) & 1) || side[nearest] != side[id]))
+        nearestStale[id] = 1;
 
-      if ((temp < distance)
-      ||  (temp == distance && absoluteDifference(it->size(), it2->size()) < sizeDiff))
-      {
-        distance = temp;
-        cut1 = *it;
-        cut2 = *it2;
-        sizeDiff = absoluteDifference(cut1.size(), cut2.size());
-      }
+      (side[id] ? liveChanged : liveUnchanged).push_back(id);
     }
   }
 
-  Cut mergedCut(numElementsPerCut);
-  for (std::size_t i = 0; i < numElementsPerCut; ++i)
+  for (auto c = std::begin(liveChanged); c != std::end(liveChanged); ++c)
   {
-    if (cut1[i] || cut2[i])
-      mergedCut.add(i);
+    const Cut &cut = *cutById[*c];
+    for (auto u = std::begin(liveUnchanged); u != std::end(liveUnchanged); ++u)
+    {
+      const std::size_t distance = cut.distance(*cutById[*u]);
+      offerNearest(*c, *u, distance);
+      offerNearest(*u, *c, distance);
+    }
   }
-  return mergedCut;
 }
 
 
 //------------------------------------------------------------------------------
-// Returns a copy of the original std::set<Cut>
+// Compares the cut with the given id with every other cut, which makes its
+// nearest cut exact. A new cut is also offered to the others; the others
+// already hold a pair at least as close as any with a cut that was there.
 //------------------------------------------------------------------------------
-std::set<Cut> CutSet::getRawSet() const
+void CutSet::scanNearest(const std::size_t id, const bool isNew) const
 {
-  return cuts;
+  const Cut &cut = *cutById[id];
+  nearestId[id] = NO_CUT;
+  nearestStale[id] = 0;
+
+  for (std::size_t w = 0; w < liveIds.size(); ++w)
+  {
+    for (std::uint64_t word = liveIds[w]; word; word &= word - 1)
+    {
+      const std::size_t other = (w << 6) + __builtin_ctzll(word);
+      if (other == id)
+        continue;
+
+      const std::size_t distance = cut.distance(*cutById[other]);
+      offerNearest(id, other, distance);
+      if (isNew)
+        offerNearest(other, id, distance);
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the ids of the cuts in the set that are proper subsets of the given
+// cut. Counts, for every cut in the set, how many of the given cut's states it
+// holds, unless comparing the smaller cuts word by word is cheaper.
+//------------------------------------------------------------------------------
+std::vector<std::size_t> CutSet::storedSubsetsOf(const Cut &cut) const
+{
+  std::vector<std::size_t> subsets;
+  if (cuts.empty() || cuts.begin()->size() >= cut.size())
+    return subsets;
+
+  const std::vector<std::size_t> &elements = cut.getTrueElements();
+  std::size_t countingCost = 0;
+  for (auto it = std::begin(elements); it != std::end(elements); ++it)
+    countingCost += numCutsWithState[*it] + idWords();
+  const std::size_t scanningCost = cuts.size() * ((numElementsPerCut + 63) >> 6);
+
+  if (scanningCost < countingCost)
+  {
+    for (std::size_t w = 0; w < liveIds.size(); ++w)
+    {
+      std::uint64_t word = liveIds[w];
+      while (word)
+      {
+        const std::size_t id = (w << 6) + __builtin_ctzll(word);
+        if (cutById[id]->size() < cut.size() && cutById[id]->isSubsetOf(cut))
+          subsets.push_back(id);
+        word &= word - 1;
+      }
+    }
+    return subsets;
+  }
+
+  std::vector<std::size_t> count(cutById.size(), 0);
+  for (auto it = std::begin(elements); it != std::end(elements); ++it)
+  {
+    const std::vector<std::uint64_t> &row = cutsWithState[*it];
+    for (std::size_t w = 0; w < row.size(); ++w)
+    {
+      std::uint64_t word = row[w];
+      while (word)
+      {
+        ++count[(w << 6) + __builtin_ctzll(word)];
+        word &= word - 1;
+      }
+    }
+  }
+
+  for (std::size_t w = 0; w < liveIds.size(); ++w)
+  {
+    std::uint64_t word = liveIds[w];
+    while (word)
+    {
+      const std::size_t id = (w << 6) + __builtin_ctzll(word);
+      if (count[id] == cutById[id]->size() && count[id] < cut.size())
+        subsets.push_back(id);
+      word &= word - 1;
+    }
+  }
+  return subsets;
 }
 
 
@@ -323,10 +576,35 @@ std::size_t CutSet::greatestCardinalityOfIntersection(const Cut &other) const
 }
 
 
+//------------------------------------------------------------------------------
+// Starts keeping the nearest cut of every cut, if it is not kept already. All
+// cuts start out stale with a bound of zero, so each is scanned when needed.
+//------------------------------------------------------------------------------
+void CutSet::keepNearest() const
+{
+  if (nearestKept)
+    return;
+
+  std::fill(std::begin(nearestDistance), std::end(nearestDistance), 0);
+  std::fill(std::begin(nearestSizeDiff), std::end(nearestSizeDiff), 0);
+  std::fill(std::begin(nearestStale), std::end(nearestStale), 1);
+  nearestKept = true;
+}
+
+
 //------------------------------------------------------------------------------
 // Adds the marker to all the cuts and keeps the marker number in the
 // markersInAllCuts set. Whenever a new cut is added, all markers in that set
 // are automatically added to the new cut.
+//
+// Only cuts that lacked the marker change. A changed cut cannot become a
+// subset of another cut (that would have held before the change) unless it
+// equals an unchanged cut, so the only other new subsets are unchanged cuts
+// (which already held the marker) within a changed cut.
+//
+// Distances among the changed cuts, and among the unchanged cuts, stay the
+// same, as does their order, so a cut whose nearest cut is on its own side
+// only has to be compared with the other side.
 //------------------------------------------------------------------------------
 bool CutSet::keepMarkerInAllCuts(const std::size_t markNum)
 {
@@ -336,47 +614,67 @@ bool CutSet::keepMarkerInAllCuts(const std::size_t markNum)
   if (markerAlreadyInAllCuts)
     return false;
 
-  std::stack<Cut> cutsToAddBack;
+  // *
+  // * Add the marker to the cuts without it
+  // *
+  std::vector<std::size_t> changed;
+  std::vector<std::size_t> unchanged;
+  const std::vector<std::uint64_t> &withMarker = cutsWithState[markNum];
+  for (std::size_t w = 0; w < liveIds.size(); ++w)
+  {
+    const std::uint64_t marked = (w < withMarker.size() ? withMarker[w] : 0);
+    for (std::uint64_t word = liveIds[w] & ~marked; word; word &= word - 1)
+      changed.push_back((w << 6) + __builtin_ctzll(word));
+    for (std::uint64_t word = liveIds[w] & marked; word; word &= word - 1)
+      unchanged.push_back((w << 6) + __builtin_ctzll(word));
+  }
 
+  for (auto it = std::begin(changed); it != std::end(changed); ++it)
   {
-    auto it = std::begin(cuts);
-    while (it != std::end(cuts))
+    Cut cut(*cutById[*it]);
+    cut.add(markNum);
+    cuts.erase(cutById[*it]);
+
+    const auto inserted = cuts.insert(std::move(cut));
+    if (inserted.second)
     {
-      bool advance = true;
+      cutById[*it] = inserted.first;
+      indexState(markNum, *it);
+      maxSize_ = std::max(maxSize_, inserted.first->size());
+      continue;
+    }
 
-      if (!(*it)[markNum])
+    // *
+    // * The changed cut equals an unchanged cut, which is kept. Drop the
+    // * changed cut's id from the index (it never held the marker).
+    // *
+    const std::vector<std::size_t> &elements = inserted.first->getTrueElements();
+    const std::uint64_t bit = std::uint64_t(1) << (*it & 63);
+    for (auto e = std::begin(elements); e != std::end(elements); ++e)
+    {
+      if (*e != markNum)
       {
-        Cut cut(*it);
-        cut.add(markNum);
-        cutsToAddBack.push(cut);
-
-        if (it != std::begin(cuts))
-        {
-          const auto prev = std::prev(it);
-          cuts.erase(it);
-          it = prev;
-        }
-        else
-        {
-          cuts.erase(it);
-          it = std::begin(cuts);
-          advance = false;
-        }
+        cutsWithState[*e][*it >> 6] &= ~bit;
+        --numCutsWithState[*e];
       }
-
-      if (cuts.empty())
-        break;
-      else if (advance)
-        ++it;
     }
+    liveIds[*it >> 6] &= ~bit;
+    freeIds.push_back(*it);
   }
 
-  while ( !cutsToAddBack.empty() )
+  // *
+  // * Erase the unchanged cuts that are now proper subsets of a changed cut
+  // *
+  for (auto it = std::begin(unchanged); it != std::end(unchanged); ++it)
   {
-    add(cutsToAddBack.top());
-    cutsToAddBack.pop();
+    const Cut &cut = *cutById[*it];
+    if (isWithinStoredCut(cut.getTrueElements(), cut.size() + 1))
+      eraseCut(*it);
   }
 
+  if (nearestKept)
+    refreshNearestAcross(changed);
+
   return true;
 }
 
@@ -2,12 +2,28 @@
 #define CUT_SET_H
 
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <set>
 #include <stack>
 
 #include "Cut.h"
 
+// *
+// * The cuts are kept in a std::set ordered by size. Each stored cut also has
+// * an id, and an inverted index holds, for each marker state, a bitset over
+// * the ids of the cuts containing it. "Is this set of states within some
+// * stored cut" is then an AND of the bitsets of its states, and "which stored
+// * cuts are within this cut" is answered by counting, for each stored cut,
+// * how many of the cut's states it contains.
+// *
+// * Once a merged cut has been asked for, every stored cut also keeps its
+// * nearest other cut, so the closest pair is a pass over the ids instead of
+// * over all pairs. A new cut is compared with the others once. When a cut's
+// * nearest cut is erased, the old distance is kept as a lower bound (the cut
+// * is stale), and it is only scanned again if that bound could be the
+// * closest pair.
+// *
 class CutSet
 {
   private:
@@ -16,11 +32,45 @@ class CutSet
     std::size_t maxSize_;
     std::size_t numElementsPerCut;
 
+    std::vector<std::set<Cut>::const_iterator> cutById;    // valid for ids set in liveIds
+    std::vector<std::uint64_t> liveIds;
+    std::vector<std::size_t> freeIds;
+    std::vector<std::vector<std::uint64_t> > cutsWithState; // empty until a cut holds the state
+    std::vector<std::size_t> numCutsWithState;
+    mutable std::vector<std::size_t> nearestId;            // NO_CUT if there is no other cut
+    mutable std::vector<std::size_t> nearestDistance;      // a lower bound if stale
+    mutable std::vector<std::size_t> nearestSizeDiff;
+    mutable std::vector<char> nearestStale;
+    mutable bool nearestKept;
+
+    static const std::size_t NO_CUT;
+
     std::size_t absoluteDifference(const std::size_t, const std::size_t) const;
+    void eraseCut(const std::size_t);
+    std::size_t idWords() const;
+    void indexState(const std::size_t, const std::size_t);
+    std::size_t insertCut(Cut);
+    bool isCloserPair(const std::size_t, const std::size_t, const std::size_t,
+                      const std::size_t, const std::size_t, const std::size_t) const;
+    bool isWithinStoredCut(const std::vector<std::size_t> &, const std::size_t) const;
+    void keepNearest() const;
+    std::size_t nearestPairAmong(const std::size_t) const;
+    void offerNearest(const std::size_t, const std::size_t, const std::size_t) const;
+    void refreshNearestAcross(const std::vector<std::size_t> &) const;
+    void scanNearest(const std::size_t, const bool) const;
+    std::vector<std::size_t> storedSubsetsOf(const Cut &) const;
 
   public:
+    typedef std::set<Cut>::const_iterator const_iterator;
+
     CutSet(const std::size_t);
+    CutSet(const CutSet &) = delete;
+    CutSet &operator=(const CutSet &) = delete;
+
     bool add(Cut);
+    const_iterator begin() const;
+    bool contains(const Cut &) const;
+    const_iterator end() const;
     bool exists(const Cut &) const;
     bool exists(const std::vector<std::size_t> &) const;
     std::vector<std::vector<char> > get2dCharVector() const;
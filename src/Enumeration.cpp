@@ -0,0 +1,331 @@
+#include "Enumeration.h"
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <thread>
+
+#include "CSFS.h"
+#include "MessageBuffer.h"
+#include "Parallel.h"
+
+namespace
+{
+  // Most states enumerated, so the number of combinations fits in 64 bits
+  const std::size_t MAX_ENUMERATED_STATES = 2000000;
+
+
+  //----------------------------------------------------------------------------
+  // Returns the number of combinations of k of n items. Each step is exact,
+  // since count is C(n, i) before it.
+  //----------------------------------------------------------------------------
+  std::uint64_t numCombinations(const std::uint64_t n, const std::size_t k)
+  {
+    if (n < k)
+      return 0;
+
+    std::uint64_t count = 1;
+    for (std::size_t i = 0; i < k; ++i)
+      count = count * (n - i) / (i + 1);
+    return count;
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Returns the coordinates of the combination at the given position in the
+  // order of CSFS::getNextEnumerationCoords()
+  //----------------------------------------------------------------------------
+  std::vector<std::size_t> coordsAt(std::uint64_t position, const std::size_t n, const std::size_t k)
+  {
+    std::vector<std::size_t> coords(k);
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < k; ++i, ++c)
+    {
+      for (std::uint64_t count; position >= (count = numCombinations(n - c - 1, k - i - 1)); ++c)
+        position -= count;
+      coords[i] = c;
+    }
+    return coords;
+  }
+
+
+  // *
+  // * The rows of the enumerated states, cut down to the words holding each
+  // * group and masked to it. Shared by the solver threads of a rank.
+  // *
+  struct GroupRows
+  {
+    std::vector<std::size_t> states; // enumerated states, most group one carriers first
+    std::size_t oneWords;
+    std::size_t twoWords;
+    std::vector<std::uint64_t> one;  // oneWords for each enumerated state
+    std::vector<std::uint64_t> two;
+
+    GroupRows(const CSFS_Data &data, const double threshold)
+    {
+      const StateMatrix &exprs = data.exprs;
+      const std::size_t oneFirst = data.grpOneStart >> 6;
+      const std::size_t twoFirst = data.grpTwoStart >> 6;
+      oneWords = (data.grpOneEnd >> 6) - oneFirst + 1;
+      twoWords = (data.grpTwoEnd >> 6) - twoFirst + 1;
+
+      std::vector<std::uint64_t> oneMask(exprs.stateRowWords(), 0);
+      std::vector<std::uint64_t> twoMask(exprs.stateRowWords(), 0);
+      for (std::size_t j = data.grpOneStart; j <= data.grpOneEnd; ++j)
+        StateMatrix::setBit(&oneMask, j);
+      for (std::size_t j = data.grpTwoStart; j <= data.grpTwoEnd; ++j)
+        StateMatrix::setBit(&twoMask, j);
+
+      // *
+      // * A state carried by too few group one individuals is in no pattern
+      // * that reaches the threshold
+      // *
+      std::vector<std::size_t> numGrpOneCarrying(data.numStates);
+      for (std::size_t i = 0; i < data.numStates; ++i)
+      {
+        numGrpOneCarrying[i] = exprs.countCarrying(i, data.grpOneStart, data.grpOneEnd);
+        if (numGrpOneCarrying[i] / static_cast<double>(data.numGrpOne) >= threshold)
+          states.push_back(i);
+      }
+      std::stable_sort(std::begin(states), std::end(states),
+                       [&numGrpOneCarrying](const std::size_t a, const std::size_t b) {
+                         return numGrpOneCarrying[a] > numGrpOneCarrying[b];
+                       });
+
+      one.reserve(states.size() * oneWords);
+      two.reserve(states.size() * twoWords);
+      for (auto it = std::begin(states); it != std::end(states); ++it)
+      {
+        const std::uint64_t *row = exprs.stateRow(*it);
+        for (std::size_t w = 0; w < oneWords; ++w)
+          one.push_back(row[oneFirst + w] & oneMask[oneFirst + w]);
+        for (std::size_t w = 0; w < twoWords; ++w)
+          two.push_back(row[twoFirst + w] & twoMask[twoFirst + w]);
+      }
+    }
+  };
+
+
+  //----------------------------------------------------------------------------
+  // Scores the combinations from start to end (inclusive) and returns the
+  // patterns with objective value at or above the threshold, or only the best
+  // one if pool is false. The carriers of each prefix of the coordinates are
+  // kept, and only those after the first coordinate that changed are updated.
+  // When a prefix can't reach the threshold, the coordinates after it jump
+  // to their last values, so the next combination has a new prefix.
+  //----------------------------------------------------------------------------
+  std::vector<Solution> searchRange(const CSFS_Data &data,
+                                    const GroupRows &rows,
+                                    const std::vector<std::size_t> &start,
+                                    const std::vector<std::size_t> &end,
+                                    const double threshold,
+                                    const bool pool)
+  {
+    const std::size_t n = rows.states.size();
+    const std::size_t k = start.size();
+    const std::size_t oneWords = rows.oneWords;
+    const std::size_t twoWords = rows.twoWords;
+
+    std::vector<std::uint64_t> one((k + 1) * oneWords, ~std::uint64_t(0)); // carriers of each prefix
+    std::vector<std::uint64_t> two((k + 1) * twoWords, ~std::uint64_t(0));
+    std::vector<std::size_t> numGrpOne(k + 1, data.numGrpOne);
+
+    std::vector<Solution> solutions;
+    std::vector<std::size_t> coords(start);
+    std::vector<std::size_t> prev;
+
+    do
+    {
+      std::size_t d = 0;
+      while (d < prev.size() && coords[d] == prev[d])
+        ++d;
+
+      bool pruned = false;
+      for (; d < k; ++d)
+      {
+        const std::uint64_t *prevOne = &one[d * oneWords];
+        const std::uint64_t *rowOne = &rows.one[coords[d] * oneWords];
+        std::uint64_t *nextOne = &one[(d + 1) * oneWords];
+        std::size_t count = 0;
+        for (std::size_t w = 0; w < oneWords; ++w)
+        {
+          nextOne[w] = prevOne[w] & rowOne[w];
+          count += StateMatrix::popcount(nextOne[w]);
+        }
+        numGrpOne[d + 1] = count;
+
+        // Adding states can only remove carriers, so this bounds the prefix
+        const double bound = CSFS::getObjectiveValue(count, 0, &data);
+        if (bound < threshold || bound <= 0 || (!pool && !solutions.empty() && bound <= solutions.front().objValue))
+        {
+          for (std::size_t e = d + 1; e < k; ++e)
+            coords[e] = n - k + e;
+          pruned = true;
+          break;
+        }
+
+        const std::uint64_t *prevTwo = &two[d * twoWords];
+        const std::uint64_t *rowTwo = &rows.two[coords[d] * twoWords];
+        std::uint64_t *nextTwo = &two[(d + 1) * twoWords];
+        for (std::size_t w = 0; w < twoWords; ++w)
+          nextTwo[w] = prevTwo[w] & rowTwo[w];
+      }
+      prev = coords;
+
+      if (pruned)
+        continue;
+
+      const std::uint64_t *carriers = &two[k * twoWords];
+      std::size_t numGrpTwo = 0;
+      for (std::size_t w = 0; w < twoWords; ++w)
+        numGrpTwo += StateMatrix::popcount(carriers[w]);
+
+      const double objValue = CSFS::getObjectiveValue(numGrpOne[k], numGrpTwo, &data);
+      if (objValue < threshold || objValue <= 0)
+        continue;
+      if (!pool && !solutions.empty() && objValue <= solutions.front().objValue)
+        continue;
+
+      std::vector<std::size_t> pattern(k);
+      for (std::size_t d = 0; d < k; ++d)
+        pattern[d] = rows.states[coords[d]];
+      std::sort(std::begin(pattern), std::end(pattern));
+
+      if (!pool)
+        solutions.clear();
+      solutions.push_back(Solution(pattern, objValue));
+    }
+    while (CSFS::getNextEnumerationCoords(&coords, n, end));
+
+    return solutions;
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Adds the solutions in from to those in to, keeping only the best one if
+  // pool is false
+  //----------------------------------------------------------------------------
+  void merge(const std::vector<Solution> &from, const bool pool, std::vector<Solution> *to)
+  {
+    for (auto it = std::begin(from); it != std::end(from); ++it)
+    {
+      if (pool)
+        to->push_back(*it);
+      else if (to->empty() || it->objValue > to->front().objValue)
+        to->assign(1, *it);
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Returns every pattern with objective value at or above
+// SOLUTION_POOL_THRESHOLD, or, without a threshold, the best pattern at or
+// above the given lower bound, best first. Every rank must call this, and
+// the patterns are returned on rank 0; other ranks get an empty vector.
+//------------------------------------------------------------------------------
+std::vector<Solution> Enumeration::solve(const CSFS_Data &data, const double lb)
+{
+  if (data.setSize > 3)
+    throw std::logic_error("Enumeration::solve: PATTERN_SIZE must be at most 3");
+
+  const int world_rank = Parallel::getWorldRank();
+  const int world_size = Parallel::getWorldSize();
+  const bool pool = data.USE_SOLUTION_POOL_THRESHOLD;
+  const double threshold = (pool ? data.SOLUTION_POOL_THRESHOLD : std::max(lb, data.STARTING_LOWER_BOUND)) - data.TOL;
+
+  const GroupRows rows(data, threshold);
+  if (rows.states.size() > MAX_ENUMERATED_STATES)
+    throw std::runtime_error("Too many marker states to enumerate every pattern.");
+
+  // *
+  // * Split the combinations into equal ranges, one for each thread of each
+  // * rank
+  // *
+  const std::size_t k = data.setSize;
+  const std::uint64_t total = numCombinations(rows.states.size(), k);
+  const std::uint64_t numRanges = static_cast<std::uint64_t>(world_size) * data.WORKER_THREADS;
+  auto firstOf = [total, numRanges](const std::uint64_t r) {
+    return (total / numRanges) * r + std::min(r, total % numRanges);
+  };
+
+  std::vector<std::vector<Solution> > found(data.WORKER_THREADS);
+  std::vector<std::exception_ptr> errors(data.WORKER_THREADS);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < data.WORKER_THREADS; ++t)
+  {
+    const std::uint64_t r = static_cast<std::uint64_t>(world_rank) * data.WORKER_THREADS + t;
+    const std::uint64_t first = firstOf(r);
+    const std::uint64_t last = firstOf(r + 1);
+    if (first == last)
+      continue;
+
+    threads.emplace_back([&, t, first, last]() {
+      try
+      {
+        found[t] = searchRange(data, rows,
+                               coordsAt(first, rows.states.size(), k),
+                               coordsAt(last - 1, rows.states.size(), k),
+                               threshold, pool);
+      }
+      catch (...)
+      {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  for (auto it = std::begin(threads); it != std::end(threads); ++it)
+    it->join();
+  for (auto it = std::begin(errors); it != std::end(errors); ++it)
+  {
+    if (*it)
+      std::rethrow_exception(*it);
+  }
+
+  std::vector<Solution> solutions;
+  for (auto it = std::begin(found); it != std::end(found); ++it)
+    merge(*it, pool, &solutions);
+
+  // *
+  // * Rank 0 gathers the patterns: their number, then each one's objective
+  // * value and states
+  // *
+  if (world_rank != 0)
+  {
+    MessageBuffer buffer;
+    buffer.put(static_cast<std::uint64_t>(solutions.size()));
+    for (auto it = std::begin(solutions); it != std::end(solutions); ++it)
+    {
+      buffer.put(it->objValue);
+      for (std::size_t d = 0; d < k; ++d)
+        buffer.put(static_cast<std::uint32_t>(it->markerStates[d]));
+    }
+
+    MPI_Request request;
+    buffer.isend(0, Parallel::SPARSE_TAG, &request);
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    return std::vector<Solution>();
+  }
+
+  for (int source = 1; source < world_size; ++source)
+  {
+    MessageBuffer buffer;
+    MPI_Status status;
+    buffer.receive(source, Parallel::SPARSE_TAG, &status);
+
+    std::vector<Solution> received(buffer.get<std::uint64_t>());
+    for (auto it = std::begin(received); it != std::end(received); ++it)
+    {
+      it->objValue = buffer.get<double>();
+      it->markerStates.resize(k);
+      for (std::size_t d = 0; d < k; ++d)
+        it->markerStates[d] = buffer.get<std::uint32_t>();
+    }
+    merge(received, pool, &solutions);
+  }
+
+  std::sort(std::begin(solutions), std::end(solutions),
+            [](const Solution &a, const Solution &b) {
+              return a.objValue > b.objValue || (a.objValue == b.objValue && a.markerStates < b.markerStates);
+            });
+  return solutions;
+}
@@ -0,0 +1,23 @@
+#ifndef ENUMERATION_H
+#define ENUMERATION_H
+
+#include <vector>
+#include "CSFS_Data.h"
+#include "Solution.h"
+
+// *
+// * Solves small problems (PATTERN_SIZE up to 3) by scoring every combination
+// * of states, without the relaxation or the sparse problems. The
+// * combinations, in the order of CSFS::getNextEnumerationCoords(), are split
+// * into equal ranges, one for each solver thread of each rank. The carriers
+// * of each prefix of a combination are kept as bitsets, so a combination
+// * costs one AND and popcount of its last state's row, and every combination
+// * of a prefix whose group one carriers fall short of the threshold is
+// * skipped.
+// *
+namespace Enumeration
+{
+  std::vector<Solution> solve(const CSFS_Data &, const double);
+}
+
+#endif
@@ -0,0 +1,253 @@
+#include "Heuristic.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "CSFS.h"
+#include "MessageBuffer.h"
+#include "Parallel.h"
+
+namespace
+{
+  // Most rounds of swaps made to improve each greedy pattern
+  const std::size_t MAX_SWAP_ROUNDS = 100;
+
+  class PatternSearch
+  {
+    private:
+      const CSFS_Data &data;
+      const StateMatrix &exprs;
+      const std::size_t words;
+
+      std::vector<std::uint64_t> grpOne; // mask of the group one individuals
+      std::vector<std::uint64_t> grpTwo;
+      std::vector<std::size_t> numGrpOneCarrying;
+      std::vector<std::size_t> byCoverage; // states, most group one carriers first
+
+    public:
+      PatternSearch(const CSFS_Data &_data) : data(_data),
+                                              exprs(_data.exprs),
+                                              words(_data.exprs.stateRowWords()),
+                                              grpOne(words, 0),
+                                              grpTwo(words, 0),
+                                              numGrpOneCarrying(_data.numStates)
+      {
+        for (std::size_t j = data.grpOneStart; j <= data.grpOneEnd; ++j)
+          StateMatrix::setBit(&grpOne, j);
+        for (std::size_t j = data.grpTwoStart; j <= data.grpTwoEnd; ++j)
+          StateMatrix::setBit(&grpTwo, j);
+
+        byCoverage.resize(data.numStates);
+        for (std::size_t i = 0; i < data.numStates; ++i)
+        {
+          numGrpOneCarrying[i] = exprs.countCarrying(i, data.grpOneStart, data.grpOneEnd);
+          byCoverage[i] = i;
+        }
+        std::sort(std::begin(byCoverage), std::end(byCoverage),
+                  [this](const std::size_t a, const std::size_t b) {
+                    return numGrpOneCarrying[a] > numGrpOneCarrying[b]
+                        || (numGrpOneCarrying[a] == numGrpOneCarrying[b] && a < b);
+                  });
+      }
+
+
+      //------------------------------------------------------------------------
+      // Returns the states in order of their objective value on their own
+      //------------------------------------------------------------------------
+      std::vector<std::size_t> statesByObjective() const
+      {
+        std::vector<double> objValue(data.numStates);
+        for (std::size_t i = 0; i < data.numStates; ++i)
+          objValue[i] = CSFS::getObjectiveValue(numGrpOneCarrying[i],
+                                                exprs.countCarrying(i, data.grpTwoStart, data.grpTwoEnd),
+                                                &data);
+
+        std::vector<std::size_t> states(byCoverage);
+        std::sort(std::begin(states), std::end(states),
+                  [&objValue](const std::size_t a, const std::size_t b) {
+                    return objValue[a] > objValue[b] || (objValue[a] == objValue[b] && a < b);
+                  });
+        return states;
+      }
+
+
+      //------------------------------------------------------------------------
+      // Sets carriers to the individuals carrying every state of the pattern
+      // but the one at position skip
+      //------------------------------------------------------------------------
+      void carriersOf(const std::vector<std::size_t> &pattern,
+                      const std::size_t skip,
+                      std::vector<std::uint64_t> *carriers) const
+      {
+        carriers->assign(words, ~std::uint64_t(0));
+        for (std::size_t k = 0; k < pattern.size(); ++k)
+        {
+          if (k == skip)
+            continue;
+          const std::uint64_t *row = exprs.stateRow(pattern[k]);
+          for (std::size_t w = 0; w < words; ++w)
+            (*carriers)[w] &= row[w];
+        }
+      }
+
+
+      //------------------------------------------------------------------------
+      // Returns the objective value of the pattern carried by the given
+      // individuals
+      //------------------------------------------------------------------------
+      double objective(const std::vector<std::uint64_t> &carriers) const
+      {
+        std::size_t numOne = 0;
+        std::size_t numTwo = 0;
+        for (std::size_t w = 0; w < words; ++w)
+        {
+          numOne += StateMatrix::popcount(carriers[w] & grpOne[w]);
+          numTwo += StateMatrix::popcount(carriers[w] & grpTwo[w]);
+        }
+        return CSFS::getObjectiveValue(numOne, numTwo, &data);
+      }
+
+
+      //------------------------------------------------------------------------
+      // Finds the state not in the pattern that gives the best objective value
+      // with the given carriers. Returns the objective value, or lowest() if
+      // every state is in the pattern. A state can't do better than its own
+      // group one coverage, so the scan stops at the first state that can't
+      // beat the best found.
+      //------------------------------------------------------------------------
+      double bestAddition(const std::vector<std::uint64_t> &carriers,
+                          const std::vector<std::size_t> &pattern,
+                          std::size_t *best) const
+      {
+        double bestObjValue = std::numeric_limits<double>::lowest();
+        *best = data.numStates;
+
+        for (auto it = std::begin(byCoverage); it != std::end(byCoverage); ++it)
+        {
+          if (*best < data.numStates
+          &&  CSFS::getObjectiveValue(numGrpOneCarrying[*it], 0, &data) <= bestObjValue)
+            break;
+          if (std::find(std::begin(pattern), std::end(pattern), *it) != std::end(pattern))
+            continue;
+
+          const std::uint64_t *row = exprs.stateRow(*it);
+          std::size_t numOne = 0;
+          std::size_t numTwo = 0;
+          for (std::size_t w = 0; w < words; ++w)
+          {
+            const std::uint64_t both = carriers[w] & row[w];
+            numOne += StateMatrix::popcount(both & grpOne[w]);
+            numTwo += StateMatrix::popcount(both & grpTwo[w]);
+          }
+
+          const double objValue = CSFS::getObjectiveValue(numOne, numTwo, &data);
+          if (objValue > bestObjValue)
+          {
+            bestObjValue = objValue;
+            *best = *it;
+          }
+        }
+
+        return bestObjValue;
+      }
+
+
+      //------------------------------------------------------------------------
+      // Grows a pattern from the given state, adding the best state each time,
+      // then swaps one state at a time for a better one while that improves
+      // the objective value. Returns the pattern and sets its objective value.
+      //------------------------------------------------------------------------
+      std::vector<std::size_t> search(const std::size_t start, double *objValue) const
+      {
+        std::vector<std::size_t> pattern(1, start);
+        std::vector<std::uint64_t> carriers;
+
+        while (pattern.size() < data.setSize)
+        {
+          std::size_t next;
+          carriersOf(pattern, pattern.size(), &carriers);
+          bestAddition(carriers, pattern, &next);
+          if (next == data.numStates)
+            break;
+          pattern.push_back(next);
+        }
+
+        carriersOf(pattern, pattern.size(), &carriers);
+        *objValue = objective(carriers);
+
+        bool improved = true;
+        for (std::size_t round = 0; improved && round < MAX_SWAP_ROUNDS; ++round)
+        {
+          improved = false;
+          for (std::size_t k = 0; k < pattern.size(); ++k)
+          {
+            std::size_t swap;
+            carriersOf(pattern, k, &carriers);
+            const double swapObjValue = bestAddition(carriers, pattern, &swap);
+            if (swap < data.numStates && swapObjValue > *objValue + data.TOL)
+            {
+              pattern[k] = swap;
+              *objValue = swapObjValue;
+              improved = true;
+            }
+          }
+        }
+
+        std::sort(std::begin(pattern), std::end(pattern));
+        return pattern;
+      }
+  };
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the best pattern the heuristic finds on any rank, and sets its
+// objective value. Every rank must call this; each one searches from its
+// share of the starts. Returns an empty vector if no pattern with a positive
+// objective value was found.
+//------------------------------------------------------------------------------
+std::vector<std::size_t> Heuristic::bestPattern(const CSFS_Data &data, double *objValue)
+{
+  const int world_rank = Parallel::getWorldRank();
+  const int world_size = Parallel::getWorldSize();
+
+  const PatternSearch patternSearch(data);
+  const std::vector<std::size_t> starts = patternSearch.statesByObjective();
+  const std::size_t numStarts = std::min(data.HEURISTIC_STARTS, starts.size());
+
+  std::vector<std::size_t> best;
+  struct { double value; int start; } local, global;
+  local.value = std::numeric_limits<double>::lowest();
+  local.start = world_rank;
+
+  for (std::size_t s = world_rank; s < numStarts; s += world_size)
+  {
+    double startObjValue;
+    const std::vector<std::size_t> pattern = patternSearch.search(starts[s], &startObjValue);
+    if (pattern.size() == data.setSize && startObjValue > local.value)
+    {
+      best = pattern;
+      local.value = startObjValue;
+      local.start = s;
+    }
+  }
+
+  // *
+  // * Every rank takes the best pattern, from the first start that found it
+  // * so that the pattern (and the states presolve keeps) doesn't depend on
+  // * the number of ranks. Start s was searched by rank s % world_size.
+  // *
+  MPI_Allreduce(&local, &global, 1, MPI_DOUBLE_INT, MPI_MAXLOC, MPI_COMM_WORLD);
+  const int bestRank = global.start % world_size;
+
+  MessageBuffer buffer;
+  if (world_rank == bestRank)
+    buffer.putIndexSet(best, data.numStates);
+  buffer.broadcast(bestRank);
+  best = buffer.getIndexSet(data.numStates);
+
+  *objValue = global.value;
+  if (best.size() != data.setSize || global.value <= 0)
+    return std::vector<std::size_t>();
+  return best;
+}
@@ -0,0 +1,21 @@
+#ifndef HEURISTIC_H
+#define HEURISTIC_H
+
+#include <vector>
+#include "CSFS_Data.h"
+
+// *
+// * Finds a good pattern quickly before cut and solve, so the search starts
+// * from its objective value instead of STARTING_LOWER_BOUND. Each of the
+// * HEURISTIC_STARTS states with the best objective value on their own starts
+// * a greedy pattern, which grows by the state that keeps the best objective
+// * value and is then improved by swapping one state at a time. The starts are
+// * shared out across the ranks, and carriers are counted on the bitset rows
+// * of the states.
+// *
+namespace Heuristic
+{
+  std::vector<std::size_t> bestPattern(const CSFS_Data &, double *);
+}
+
+#endif
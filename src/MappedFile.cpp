@@ -0,0 +1,78 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+//    Constructor
+//------------------------------------------------------------------------------
+MappedFile::MappedFile(const std::string &filename) : bytes(NULL), size_(0)
+{
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Input file could not be opened.");
+
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+  {
+    close(fd);
+    throw std::runtime_error("Input file could not be opened.");
+  }
+  size_ = info.st_size;
+
+  // *
+  // * An empty file cannot be mapped, but is still a valid (empty) file
+  // *
+  if (size_ > 0)
+  {
+    void *mapped = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+      close(fd);
+      throw std::runtime_error("Input file could not be mapped into memory.");
+    }
+    bytes = static_cast<const char *>(mapped);
+    madvise(mapped, size_, MADV_SEQUENTIAL);
+  }
+
+  close(fd);
+}
+
+
+//------------------------------------------------------------------------------
+//    Destructor
+//------------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+  if (bytes)
+    munmap(const_cast<char *>(bytes), size_);
+}
+
+
+//------------------------------------------------------------------------------
+// Returns a pointer to the first byte of the file
+//------------------------------------------------------------------------------
+const char *MappedFile::begin() const
+{
+  return bytes;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns a pointer one past the last byte of the file
+//------------------------------------------------------------------------------
+const char *MappedFile::end() const
+{
+  return bytes + size_;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the size of the file in bytes
+//------------------------------------------------------------------------------
+std::size_t MappedFile::size() const
+{
+  return size_;
+}
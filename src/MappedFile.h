@@ -0,0 +1,30 @@
+// *
+// * Read-only memory mapping of a whole file. The mapping is released when the
+// * object is destroyed.
+// *
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+class MappedFile
+{
+  private:
+    const char *bytes;
+    std::size_t size_;
+
+  public:
+    MappedFile(const std::string &);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *begin() const;
+    const char *end() const;
+    std::size_t size() const;
+};
+
+#endif
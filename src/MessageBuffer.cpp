@@ -0,0 +1,232 @@
+#include "MessageBuffer.h"
+#include "StateMatrix.h"
+#include <algorithm>
+#include <climits>
+
+namespace
+{
+  const char SPARSE_INDEX_SET = 0;
+  const char PACKED_INDEX_SET = 1;
+}
+
+//------------------------------------------------------------------------------
+//    Constructor
+//------------------------------------------------------------------------------
+MessageBuffer::MessageBuffer() : readPos(0)
+{}
+
+
+//------------------------------------------------------------------------------
+// Replaces the contents of the buffer with a copy of the given bytes
+//------------------------------------------------------------------------------
+void MessageBuffer::assign(const char *begin, const std::size_t count)
+{
+  bytes.assign(begin, begin + count);
+  readPos = 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Broadcasts the message from the root rank to every rank. On the other ranks
+// the contents of the buffer are replaced. Messages larger than INT_MAX bytes
+// are sent in pieces.
+//------------------------------------------------------------------------------
+void MessageBuffer::broadcast(const int root)
+{
+  std::uint64_t count = bytes.size();
+  MPI_Bcast(&count, 1, MPI_UINT64_T, root, MPI_COMM_WORLD);
+
+  if (Parallel::getWorldRank() != root)
+    bytes.resize(count);
+  readPos = 0;
+
+  for (std::uint64_t sent = 0; sent < count;)
+  {
+    const int piece = static_cast<int>(std::min<std::uint64_t>(count - sent, INT_MAX));
+    MPI_Bcast(&bytes[sent], piece, MPI_BYTE, root, MPI_COMM_WORLD);
+    sent += piece;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Reads the message format version and throws if it does not match the
+// version this build writes
+//------------------------------------------------------------------------------
+void MessageBuffer::checkVersion()
+{
+  const std::uint32_t version = get<std::uint32_t>();
+  if (version != Parallel::MESSAGE_VERSION)
+    throw std::runtime_error("MessageBuffer: Received message of format version "
+                             + std::to_string(version) + ", expected "
+                             + std::to_string(Parallel::MESSAGE_VERSION));
+}
+
+
+//------------------------------------------------------------------------------
+// Empties the buffer
+//------------------------------------------------------------------------------
+void MessageBuffer::clear()
+{
+  bytes.clear();
+  readPos = 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns a pointer to the start of the message
+//------------------------------------------------------------------------------
+const char *MessageBuffer::data() const
+{
+  return bytes.data();
+}
+
+
+//------------------------------------------------------------------------------
+// Reads a set of indices in [0, universe) written by putIndexSet(). Throws if
+// the set doesn't fit in the universe, since it may come from a checkpoint
+// file that is corrupt or was written for other data.
+//------------------------------------------------------------------------------
+std::vector<std::size_t> MessageBuffer::getIndexSet(const std::size_t universe)
+{
+  std::vector<std::size_t> indices;
+  const char encoding = get<char>();
+
+  if (encoding == SPARSE_INDEX_SET)
+  {
+    const std::uint32_t count = get<std::uint32_t>();
+    if (count > universe)
+      throw std::runtime_error("MessageBuffer: Index set larger than its universe");
+
+    indices.reserve(count);
+    for (std::uint32_t k = 0; k < count; ++k)
+    {
+      const std::uint32_t index = get<std::uint32_t>();
+      if (index >= universe)
+        throw std::runtime_error("MessageBuffer: Index set element outside its universe");
+      indices.push_back(index);
+    }
+  }
+  else if (encoding == PACKED_INDEX_SET)
+  {
+    std::vector<std::uint64_t> words(StateMatrix::numWords(universe));
+    for (std::size_t w = 0; w < words.size(); ++w)
+      words[w] = get<std::uint64_t>();
+    StateMatrix::forEachBit(words.data(), words.size(), universe, false,
+                            [&](const std::size_t i) { indices.push_back(i); });
+  }
+  else
+  {
+    throw std::runtime_error("MessageBuffer: Unknown index set encoding");
+  }
+
+  return indices;
+}
+
+
+//------------------------------------------------------------------------------
+// Reads a string written by putString()
+//------------------------------------------------------------------------------
+std::string MessageBuffer::getString()
+{
+  const std::uint64_t length = get<std::uint64_t>();
+  std::string str(length, '\0');
+  getArray(&str[0], length);
+  return str;
+}
+
+
+//------------------------------------------------------------------------------
+// Starts a non-blocking send of the message. The buffer must not be modified
+// until the request completes.
+//------------------------------------------------------------------------------
+void MessageBuffer::isend(const int dest, const int tag, MPI_Request *request) const
+{
+  MPI_Isend(bytes.data(), bytes.size(), MPI_BYTE, dest, tag, MPI_COMM_WORLD, request);
+}
+
+
+//------------------------------------------------------------------------------
+// Appends a sorted set of indices in [0, universe). The set is written as a
+// list of indices if that is smaller than one bit per element of the universe.
+//------------------------------------------------------------------------------
+void MessageBuffer::putIndexSet(const std::vector<std::size_t> &indices,
+                                const std::size_t universe)
+{
+  const std::size_t numWords = StateMatrix::numWords(universe);
+
+  if (indices.size() * sizeof(std::uint32_t) < numWords * sizeof(std::uint64_t))
+  {
+    put(SPARSE_INDEX_SET);
+    put(static_cast<std::uint32_t>(indices.size()));
+    for (std::size_t k = 0; k < indices.size(); ++k)
+      put(static_cast<std::uint32_t>(indices[k]));
+  }
+  else
+  {
+    std::vector<std::uint64_t> words(numWords, 0);
+    for (std::size_t k = 0; k < indices.size(); ++k)
+      StateMatrix::setBit(&words, indices[k]);
+
+    put(PACKED_INDEX_SET);
+    for (std::size_t w = 0; w < words.size(); ++w)
+      put(words[w]);
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Appends a string, preceded by its length
+//------------------------------------------------------------------------------
+void MessageBuffer::putString(const std::string &str)
+{
+  put(static_cast<std::uint64_t>(str.size()));
+  putArray(str.data(), str.size());
+}
+
+
+//------------------------------------------------------------------------------
+// Appends the message format version. Every message starts with this.
+//------------------------------------------------------------------------------
+void MessageBuffer::putVersion()
+{
+  put(Parallel::MESSAGE_VERSION);
+}
+
+
+//------------------------------------------------------------------------------
+// Replaces the contents of the buffer with the next message of any length
+// from the given source and tag
+//------------------------------------------------------------------------------
+void MessageBuffer::receive(const int source, const int tag, MPI_Status *status)
+{
+  int count;
+  MPI_Probe(source, tag, MPI_COMM_WORLD, status);
+  MPI_Get_count(status, MPI_BYTE, &count);
+
+  bytes.resize(count);
+  readPos = 0;
+  MPI_Recv(bytes.data(), count, MPI_BYTE, status->MPI_SOURCE, status->MPI_TAG, MPI_COMM_WORLD, status);
+}
+
+
+//------------------------------------------------------------------------------
+// Moves the read position to byte offset pos, so values written from there on
+// can be read again
+//------------------------------------------------------------------------------
+void MessageBuffer::seek(const std::size_t pos)
+{
+  if (pos > bytes.size())
+    throw std::logic_error("MessageBuffer: Seek past the end of the message");
+
+  readPos = pos;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the size of the message in bytes
+//------------------------------------------------------------------------------
+std::size_t MessageBuffer::size() const
+{
+  return bytes.size();
+}
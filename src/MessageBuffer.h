@@ -0,0 +1,98 @@
+// *
+// * Contiguous byte buffer used to send a whole message (such as a sparse
+// * problem or its solution) between ranks in a single MPI call. Values are
+// * appended with put() and read back in the same order with get(). Sets of
+// * indices (cuts, fixed markers, fixed individuals) are written either as a
+// * sparse list of indices or as packed bits, whichever is smaller.
+// *
+
+#ifndef MESSAGE_BUFFER_H
+#define MESSAGE_BUFFER_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Parallel.h"
+
+class MessageBuffer
+{
+  private:
+    std::vector<char> bytes;
+    std::size_t readPos;
+
+  public:
+    MessageBuffer();
+    void assign(const char *, const std::size_t);
+    void broadcast(const int);
+    void checkVersion();
+    void clear();
+    const char *data() const;
+    std::vector<std::size_t> getIndexSet(const std::size_t);
+    std::string getString();
+    void isend(const int, const int, MPI_Request *) const;
+    void putIndexSet(const std::vector<std::size_t> &, const std::size_t);
+    void putString(const std::string &);
+    void putVersion();
+    void receive(const int, const int, MPI_Status *);
+    void seek(const std::size_t);
+    std::size_t size() const;
+
+    // Appends a plain value to the end of the buffer
+    template <typename T>
+    void put(const T &value)
+    {
+      const std::size_t pos = bytes.size();
+      bytes.resize(pos + sizeof(T));
+      std::memcpy(&bytes[pos], &value, sizeof(T));
+    }
+
+    // Appends count plain values
+    template <typename T>
+    void putArray(const T *values, const std::size_t count)
+    {
+      const std::size_t pos = bytes.size();
+      bytes.resize(pos + count * sizeof(T));
+      if (count)
+        std::memcpy(&bytes[pos], values, count * sizeof(T));
+    }
+
+    // Overwrites a plain value previously written at byte offset pos
+    template <typename T>
+    void putAt(const std::size_t pos, const T &value)
+    {
+      if (pos + sizeof(T) > bytes.size())
+        throw std::logic_error("MessageBuffer: Write past the end of the message");
+
+      std::memcpy(&bytes[pos], &value, sizeof(T));
+    }
+
+    // Reads the next plain value from the buffer
+    template <typename T>
+    T get()
+    {
+      if (readPos + sizeof(T) > bytes.size())
+        throw std::runtime_error("MessageBuffer: Read past the end of the message");
+
+      T value;
+      std::memcpy(&value, &bytes[readPos], sizeof(T));
+      readPos += sizeof(T);
+      return value;
+    }
+
+    // Reads the next count plain values from the buffer into values
+    template <typename T>
+    void getArray(T *values, const std::size_t count)
+    {
+      if (readPos + count * sizeof(T) > bytes.size())
+        throw std::runtime_error("MessageBuffer: Read past the end of the message");
+
+      if (count)
+        std::memcpy(values, &bytes[readPos], count * sizeof(T));
+      readPos += count * sizeof(T);
+    }
+};
+
+#endif
@@ -25,6 +25,11 @@ namespace Parallel
 {
   const int SPARSE_TAG = 0;
   const int CONVERGE_TAG = 1;
+  const int LOWER_BOUND_TAG = 2; // an improved lower bound for the problems a worker is solving
+
+  // Version of the packed sparse problem / solution message format. Bump this
+  // whenever the layout written by the controller or the workers changes.
+  const uint32_t MESSAGE_VERSION = 3;
 
   int getWorldRank();
   int getWorldSize();
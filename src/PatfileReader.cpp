@@ -1,17 +1,24 @@
 #include "PatfileReader.h"
 #include "Cut.h"
 #include <cassert>
+#include <iterator>
+#include <sstream>
 
 //------------------------------------------------------------------------------
 //    Constructors
 //------------------------------------------------------------------------------
 // If there is an input pattern file name stored in the CSFS_Data object, then
-// that file will be opened
+// that file will be opened. Patterns are read as states of the data file, so
+// the data must not have been presolved.
 //------------------------------------------------------------------------------
 PatternReader::PatternReader(const CSFS_Data &_data) :   data(&_data),
                                                         fileIsOpen(false),
                                                         lastPatRead(0)
 {
+  // Note: The exprsInfo also contains hearer info, so need to add 1 to index
+  for (std::size_t k = 0; k < data->numActualExprs; ++k)
+    exprNumberOfId.emplace(data->exprsInfo[k + 1][data->idColNum], k);
+
   if (!(data->inputPatfileName).empty())
     open(data->inputPatfileName);
 }
@@ -25,21 +32,29 @@ bool PatternReader::nextPatAvail() const
 }
 
 //------------------------------------------------------------------------------
-// Loads the first line of the pattern file to process
+// Loads the next line of the pattern file that isn't blank. The line is left
+// empty at the end of the file.
 //------------------------------------------------------------------------------
 void PatternReader::loadFirstLineToProcess()
 {
-    while (patfile.good())
+    std::string line;
+    nextLineToProcess.clear();
+
+    while (getline(patfile, line))
     {
-        getline(patfile, nextLineToProcess);
-        
-        if (!isWhitespace(nextLineToProcess))
+        if (!isWhitespace(line))
         {
+            nextLineToProcess = line;
             break;
         }
-    }  
+    }
 }
 
+//------------------------------------------------------------------------------
+// Returns the pattern in a line of a logfile, which holds the ID, state name
+// and value of each of its marker states. The pattern is empty if the line
+// doesn't hold PATTERN_SIZE marker states of this data set.
+//------------------------------------------------------------------------------
 Cut PatternReader::getPatFromString(const std::string &str) const
 {
     Cut cut(data->numStates);
@@ -52,39 +67,34 @@ Cut PatternReader::getPatFromString(const std::string &str) const
       for (std::size_t i = 0; i < vec.size(); i+=3)
       {
         // Find index of expression data
-        bool found_expr = false;
-        // Note: The exprsInfo also contains hearer info, so need to add 1 to index
-        for(expr_num = 0; expr_num < data->numActualExprs; ++expr_num)
-        {
-          if(data->exprsInfo[expr_num+1][data->idColNum] == vec[i])
-          {
-            found_expr = true;
-            break;            
-          }
-        }
+        const auto expr = exprNumberOfId.find(vec[i]);
+        const bool found_expr = (expr != exprNumberOfId.end());
+        if (found_expr)
+          expr_num = expr->second;
 
         if (found_expr)
         {
-          if(atof(vec[i+2].c_str()) == data->HIGH_VALUE)
+          const std::string &state = vec[i+1];
+          if(data->USE_HIGH && state == "HIGH")
             cut.add(expr_num*data->numBins + data->getHighIndex());
-          else if(atof(vec[i+2].c_str()) == data->NORM_VALUE)
+          else if(data->USE_NORM && state == "NORM")
             cut.add(expr_num*data->numBins + data->getNormIndex());
-          else if(atof(vec[i+2].c_str()) == data->LOW_VALUE)
+          else if(data->USE_LOW && state == "LOW")
             cut.add(expr_num*data->numBins + data->getLowIndex());
-          else if(atof(vec[i+2].c_str()) == data->NOT_LOW_VALUE)
+          else if(data->USE_NOT_LOW && state == "NOT_LOW")
             cut.add(expr_num*data->numBins + data->getNotLowIndex());
-          else if(atof(vec[i+2].c_str()) == data->NOT_HIGH_VALUE)
+          else if(data->USE_NOT_HIGH && state == "NOT_HIGH")
             cut.add(expr_num*data->numBins + data->getNotHighIndex());
           else
           {
-            printf("Warning - Could not find expression index for pattern\n");
+            CSFSUtils::warning("Could not find marker state " + state + " of " + vec[i] + " for pattern.");
             cut.clear();
             return cut;
           }
         }
         else
         {
-          printf("WARNING - Could not find expression name for pattrn.\n");
+          CSFSUtils::warning("Could not find expression " + vec[i] + " for pattern.");
           cut.clear();
           return cut;
         }
@@ -173,34 +183,21 @@ std::size_t PatternReader::getNumberOfLastPatRead() const
 // Returns true if a pattern was read, false otherwise.
 //
 // If a pattern was read, it returns by reference (as a cut):
-// - the next cut from the cut file
+// - the next pattern from the pattern file
+// Lines that don't hold a pattern of this data set are skipped.
+//------------------------------------------------------------------------------
 bool PatternReader::nextPat(Cut *cut)
 {
-    cut->clear();
-
-    if (!nextPatAvail())
-        return false;
-
-    while (patfile.good() || !nextLineToProcess.empty())
+    while (nextPatAvail())
     {
-        if (cut->empty())
-        {
-            *cut = getPatFromString(nextLineToProcess);
-            ++lastPatRead;
-            nextLineToProcess.clear();
-            getline(patfile, nextLineToProcess);
+        *cut = getPatFromString(nextLineToProcess);
+        ++lastPatRead;
+        loadFirstLineToProcess();
 
-            if(nextLineToProcess.empty())
-              close();
-        }
-        else
-        {
-            break;
-        }
+        if (!cut->empty())
+            return true;
     }
 
-    if (!cut->empty())
-        return true;
-    else
-        return false;
+    cut->clear();
+    return false;
 }
@@ -1,6 +1,8 @@
 #ifndef PATFILE_READER_H
 #define PATFILE_READER_H
 
+#include <fstream>
+#include <unordered_map>
 #include "CSFS_Data.h"
 
 const std::size_t NUM_ITEMS_PER_PAT_EL = 3;
@@ -14,6 +16,7 @@ class PatternReader
         bool fileIsOpen;
         std::string nextLineToProcess;
         std::size_t lastPatRead;
+        std::unordered_map<std::string, std::size_t> exprNumberOfId;
 
         void loadFirstLineToProcess();
         Cut getPatFromString(const std::string &) const;
@@ -0,0 +1,146 @@
+#include "Presolve.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+  // Most earlier states compared with each state when counting its dominators
+  const std::size_t MAX_DOMINANCE_CHECKS = 256;
+
+  struct Candidate
+  {
+    std::size_t state;
+    std::size_t numGrpOne;
+    std::size_t numGrpTwo;
+
+    // Every dominator of a state sorts before it
+    bool operator<(const Candidate &other) const
+    {
+      if (numGrpOne != other.numGrpOne)
+        return numGrpOne > other.numGrpOne;
+      if (numGrpTwo != other.numGrpTwo)
+        return numGrpTwo < other.numGrpTwo;
+      return state < other.state;
+    }
+  };
+
+
+  //----------------------------------------------------------------------------
+  // Returns true if every group one individual carrying state a also carries
+  // state b, and every group two individual carrying state b also carries
+  // state a
+  //----------------------------------------------------------------------------
+  bool dominates(const std::uint64_t *b,
+                 const std::uint64_t *a,
+                 const std::vector<std::uint64_t> &grpOne,
+                 const std::vector<std::uint64_t> &grpTwo)
+  {
+    for (std::size_t w = 0; w < grpOne.size(); ++w)
+    {
+      if (((a[w] & ~b[w]) & grpOne[w]) | ((b[w] & ~a[w]) & grpTwo[w]))
+        return false;
+    }
+    return true;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the states to keep, in increasing order. The given states (such as
+// those of a known pattern) are always kept, and every state is kept if fewer
+// than PATTERN_SIZE states would be left. The lower bound must be reached by
+// a known pattern, or be STARTING_LOWER_BOUND.
+//
+// Swapping a dominated state in a pattern for one of its dominators that
+// isn't in the pattern (or just dropping it, if a dominator is) never lowers
+// the objective value, so an optimal pattern remains. When saving every
+// pattern above SOLUTION_POOL_THRESHOLD this isn't enough, so then only the
+// coverage check is made.
+//------------------------------------------------------------------------------
+std::vector<std::size_t> Presolve::keptStates(const CSFS_Data &data,
+                                              const std::vector<std::size_t> &alwaysKept,
+                                              const double lb)
+{
+  const StateMatrix &exprs = data.exprs;
+  const double minRatio = data.USE_SOLUTION_POOL_THRESHOLD ? data.SOLUTION_POOL_THRESHOLD
+                                                           : std::max(std::max(data.STARTING_LOWER_BOUND, lb), data.TOL);
+
+  std::vector<std::size_t> allStates(data.numStates);
+  for (std::size_t i = 0; i < data.numStates; ++i)
+    allStates[i] = i;
+
+  // *
+  // * Drop the states carried by too few group one individuals
+  // *
+  std::vector<Candidate> candidates;
+  for (std::size_t i = 0; i < data.numStates; ++i)
+  {
+    const std::size_t numGrpOne = exprs.countCarrying(i, data.grpOneStart, data.grpOneEnd);
+    if (numGrpOne / static_cast<double>(data.numGrpOne) < minRatio)
+      continue;
+
+    Candidate candidate;
+    candidate.state = i;
+    candidate.numGrpOne = numGrpOne;
+    candidate.numGrpTwo = exprs.countCarrying(i, data.grpTwoStart, data.grpTwoEnd);
+    candidates.push_back(candidate);
+  }
+
+  if (candidates.size() < data.setSize)
+    return allStates;
+
+  // *
+  // * Drop the states with at least setSize dominators
+  // *
+  std::vector<char> keep(data.numStates, 0);
+  for (auto it = std::begin(candidates); it != std::end(candidates); ++it)
+    keep[it->state] = 1;
+
+  if (!data.USE_SOLUTION_POOL_THRESHOLD)
+  {
+    std::vector<std::uint64_t> grpOne(exprs.stateRowWords(), 0);
+    std::vector<std::uint64_t> grpTwo(exprs.stateRowWords(), 0);
+    for (std::size_t j = data.grpOneStart; j <= data.grpOneEnd; ++j)
+      StateMatrix::setBit(&grpOne, j);
+    for (std::size_t j = data.grpTwoStart; j <= data.grpTwoEnd; ++j)
+      StateMatrix::setBit(&grpTwo, j);
+
+    std::sort(std::begin(candidates), std::end(candidates));
+
+    std::size_t numDropped = 0;
+    for (std::size_t k = 0; k < candidates.size(); ++k)
+    {
+      if (candidates.size() - numDropped <= data.setSize)
+        break;
+
+      const Candidate &a = candidates[k];
+      const std::size_t first = k > MAX_DOMINANCE_CHECKS ? k - MAX_DOMINANCE_CHECKS : 0;
+      std::size_t numDominators = 0;
+
+      for (std::size_t l = k; l > first && numDominators < data.setSize; --l)
+      {
+        const Candidate &b = candidates[l - 1];
+        if (b.numGrpTwo <= a.numGrpTwo
+        &&  dominates(exprs.stateRow(b.state), exprs.stateRow(a.state), grpOne, grpTwo))
+          ++numDominators;
+      }
+
+      if (numDominators == data.setSize)
+      {
+        keep[a.state] = 0;
+        ++numDropped;
+      }
+    }
+  }
+
+  for (auto it = std::begin(alwaysKept); it != std::end(alwaysKept); ++it)
+    keep[*it] = 1;
+
+  std::vector<std::size_t> kept;
+  for (std::size_t i = 0; i < data.numStates; ++i)
+  {
+    if (keep[i])
+      kept.push_back(i);
+  }
+  return kept;
+}
@@ -0,0 +1,20 @@
+#ifndef PRESOLVE_H
+#define PRESOLVE_H
+
+#include <vector>
+#include "CSFS_Data.h"
+
+// *
+// * Shrinks the marker states before cut and solve. A state is dropped when
+// * too few group one individuals carry it for any pattern holding it to reach
+// * the threshold (the lower bound), or when at least PATTERN_SIZE other
+// * states dominate it: they are carried by every group one individual that
+// * carries it, and by no group two individual that doesn't. Identical states
+// * dominate their later copies.
+// *
+namespace Presolve
+{
+  std::vector<std::size_t> keptStates(const CSFS_Data &, const std::vector<std::size_t> &, const double);
+}
+
+#endif
@@ -19,16 +19,19 @@ RelaxationSolver::RelaxationSolver(const CSFS_Data &_data) : data(&_data),
                                                             obj(IloExpr(env)),
                                                             baseConstraints(IloConstraintArray(env)),
                                                             cutConstraints(IloConstraintArray(env)),
-                                                            fixedMarkConstraints(IloConstraintArray(env)),
-                                                            fixedIndivConstraints(IloConstraintArray(env)),
-                                                            indivEqualityConstraints(IloConstraintArray(env))
+                                                            numCutConstraintsInModel(0)
 {
   mark.setNames("m");
   indiv.setNames("i");
 
   buildModel();
 
+  // *
+  // * The model is extracted once. Later changes reach cplex incrementally,
+  // * and the dual simplex restarts from the previous basis.
+  // *
   cplex.extract(model);
+  cplex.setParam(IloCplex::Param::RootAlgorithm, IloCplex::Dual);
   cplex.setParam(IloCplex::Param::Threads, 1);
   cplex.setParam(IloCplex::Param::RandomSeed, data->CPLEX_SEED);
   if (!data->PRINT_CPLEX_OUTPUT)
@@ -37,11 +40,14 @@ RelaxationSolver::RelaxationSolver(const CSFS_Data &_data) : data(&_data),
 
 
 //------------------------------------------------------------------------------
-// Adds the cut to cutConstraints
+// Adds the cut to cutConstraints, to be added to the model at the next solve.
+// A cut within a cut already in the set would be a redundant row, so it is
+// skipped.
 //------------------------------------------------------------------------------
 void RelaxationSolver::add(const Cut &cut)
 {
-  cutSet.add(cut);
+  if (!cutSet.add(cut))
+    return;
 
   IloExpr cutExpr(env);
   std::size_t x = 0, i = 0;
@@ -58,6 +64,7 @@ void RelaxationSolver::add(const Cut &cut)
   IloConstraint cutConstraint(cutExpr <= static_cast<IloInt>(data->setSize - 1));
   cutConstraint.setName("Cut");
   cutConstraints.add(cutConstraint);
+  cutOfConstraint.push_back(cut);
   cutExpr.end();
 }
 
@@ -96,8 +103,7 @@ void RelaxationSolver::buildModel()
   for (std::size_t j = data->grpOneStart; j <= data->grpOneEnd; ++j)
   {
     IloExpr gij_marki(env);
-    for (std::size_t i = 0; i < data->numStates; ++i)
-      gij_marki += mark[i] * data->exprs[i][j];
+    data->exprs.forEachState(j, [&](const std::size_t i) { gij_marki += mark[i]; });
     IloConstraint indivUpper(indiv[j] <= gij_marki / data->setSize);
     std::string indivUpperName = "Indiv_" + std::to_string(j) + "_Upper";
     indivUpper.setName(indivUpperName.c_str());
@@ -107,8 +113,7 @@ void RelaxationSolver::buildModel()
   for (std::size_t j = data->grpTwoStart; j <= data->grpTwoEnd; ++j)
   {
     IloExpr gij_marki(env);
-    for (std::size_t i = 0; i < data->numStates; ++i)
-      gij_marki += mark[i] * data->exprs[i][j];
+    data->exprs.forEachState(j, [&](const std::size_t i) { gij_marki += mark[i]; });
     IloConstraint indivLower(indiv[j] >= gij_marki - data->setSize + 1);
     std::string indivLowerName = "Indiv_" + std::to_string(j) + "_Lower";
     indivLower.setName(indivLowerName.c_str());
@@ -123,38 +128,46 @@ void RelaxationSolver::buildModel()
 
 
 //------------------------------------------------------------------------------
-// Removes all cuts from the model and adds cut from the cut set.
+// Removes the rows of cuts that are no longer in the cut set.
 // Reasoning for this function is that the cut set is always cleaning itself up
 // internally so that no cut is a subset of any other cut. Cplex does not do
-// this, meaning the model could accumulate many redundant cuts.
+// this, meaning the model could accumulate many redundant cuts. The rows that
+// are kept stay in the model, so the basis is not lost.
 //------------------------------------------------------------------------------
 inline void RelaxationSolver::cleanUp()
 {
-  cutConstraints.removeFromAll();
-  cutConstraints.endElements();
-  auto rawCutSet = cutSet.getRawSet();
-  for (auto it = std::begin(rawCutSet); it != std::end(rawCutSet); ++it)
+  IloConstraintArray keptConstraints(env);
+  IloConstraintArray droppedConstraints(env);
+  std::vector<Cut> keptCuts;
+  IloInt numKeptInModel = 0;
+
+  for (IloInt k = 0; k < cutConstraints.getSize(); ++k)
   {
-    IloExpr cutExpr(env);
-    std::size_t x = 0, i = 0;
-    while (x < (*it).size())
+    if (cutSet.contains(cutOfConstraint[k]))
     {
-      if ((*it)[i])
-      {
-        cutExpr += mark[i];
-        ++x;
-      }
-      ++i;
+      keptConstraints.add(cutConstraints[k]);
+      keptCuts.push_back(std::move(cutOfConstraint[k]));
+      if (k < numCutConstraintsInModel)
+        ++numKeptInModel;
+    }
+    else if (k < numCutConstraintsInModel)
+    {
+      droppedConstraints.add(cutConstraints[k]);
+    }
+    else
+    {
+      cutConstraints[k].end(); // never reached the model
     }
-
-    IloConstraint cutConstraint(cutExpr <= static_cast<IloInt>(data->setSize - 1));
-    cutConstraint.setName("Cut");
-    cutConstraints.add(cutConstraint);
-    cutExpr.end();
   }
 
-  model.add(cutConstraints);
-  //cplex.extract(model);
+  model.remove(droppedConstraints);
+  droppedConstraints.endElements();
+  droppedConstraints.end();
+
+  cutConstraints.end();
+  cutConstraints = keptConstraints;
+  cutOfConstraint.swap(keptCuts);
+  numCutConstraintsInModel = numKeptInModel;
 }
 
 
@@ -292,24 +305,20 @@ inline void RelaxationSolver::roundExtremeValues(std::vector<std::pair<std::size
 
 
 //------------------------------------------------------------------------------
-// Adds the constraint that indiv[indivNumber] must equal val
+// Fixes indiv[indivNumber] to val by changing its bounds
 //------------------------------------------------------------------------------
 void RelaxationSolver::setIndiv(const std::size_t indivNumber, const bool val)
 {
-  IloConstraint fixedIndivConstraint(indiv[indivNumber] == static_cast<IloInt>(val));
-  fixedIndivConstraint.setName("FixedIndiv");
-  fixedIndivConstraints.add(fixedIndivConstraint);
+  indiv[indivNumber].setBounds(val, val);
 }
 
 
 //------------------------------------------------------------------------------
-// Adds the constraint that mark[markNumber] must equal val
+// Fixes mark[markNumber] to val by changing its bounds
 //------------------------------------------------------------------------------
 void RelaxationSolver::setMark(const std::size_t markNumber, const bool val)
 {
-  IloConstraint fixedMarkConstraint(mark[markNumber] == static_cast<IloInt>(val));
-  fixedMarkConstraint.setName("FixedMark");
-  fixedMarkConstraints.add(fixedMarkConstraint);
+  mark[markNumber].setBounds(val, val);
 }
 
 
@@ -320,7 +329,7 @@ void RelaxationSolver::setIndivEquality(const std::size_t x, const std::size_t y
 {
   IloConstraint indivEqualityConstraint(indiv[x] == indiv[y]);
   indivEqualityConstraint.setName("IndivEquality");
-  indivEqualityConstraints.add(indivEqualityConstraint);
+  model.add(indivEqualityConstraint);
 }
 
 
@@ -331,18 +340,21 @@ void RelaxationSolver::setIndivEquality(const std::size_t x, const std::size_t y
 void RelaxationSolver::solve()
 {
   // *
-  // * Update the model
+  // * Update the model with the cuts added since the last solve
   // *
-  if (static_cast<std::size_t>(cutConstraints.getSize()) < 2 * cutSet.numCuts())
-    model.add(cutConstraints);
-  else
+  if (static_cast<std::size_t>(cutConstraints.getSize()) >= 2 * cutSet.numCuts())
     cleanUp();
 
-  model.add(fixedMarkConstraints);
-  model.add(fixedIndivConstraints);
-  model.add(indivEqualityConstraints);
+  if (numCutConstraintsInModel < cutConstraints.getSize())
+  {
+    IloConstraintArray newConstraints(env);
+    for (IloInt k = numCutConstraintsInModel; k < cutConstraints.getSize(); ++k)
+      newConstraints.add(cutConstraints[k]);
+    model.add(newConstraints);
+    newConstraints.end();
+    numCutConstraintsInModel = cutConstraints.getSize();
+  }
 
-  cplex.extract(model);
   cplex.setParam(IloCplex::Param::RandomSeed, data->CPLEX_SEED);
 
   // *
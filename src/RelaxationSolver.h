@@ -31,9 +31,8 @@ class RelaxationSolver
     IloExpr obj;
     IloConstraintArray baseConstraints;
     IloConstraintArray cutConstraints;
-    IloConstraintArray fixedMarkConstraints;
-    IloConstraintArray fixedIndivConstraints;
-    IloConstraintArray indivEqualityConstraints;
+    std::vector<Cut> cutOfConstraint;  // the cut of each row in cutConstraints
+    IloInt numCutConstraintsInModel;   // the rest are added at the next solve
 
     Timer timer;
 
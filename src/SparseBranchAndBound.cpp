@@ -0,0 +1,341 @@
+#include "SparseBranchAndBound.h"
+#include <algorithm>
+#include <cassert>
+
+//------------------------------------------------------------------------------
+//    Constructor
+//------------------------------------------------------------------------------
+SparseBranchAndBound::SparseBranchAndBound(const CSFS_Data &_data) : data(&_data),
+                                                                    indivWords(data->exprs.stateRowWords()),
+                                                                    candWords(0),
+                                                                    numToChoose(0),
+                                                                    numCutMasks(0),
+                                                                    numGrpOneFixedToOne(0),
+                                                                    numGrpTwoFixedToOne(0),
+                                                                    threshold(0),
+                                                                    enumerate(false),
+                                                                    sharedLb(NULL),
+                                                                    nodes(0)
+{}
+
+
+//------------------------------------------------------------------------------
+// Records the pattern made of the forced states and the chosen candidates if
+// it is not contained in any cut and its objective value is high enough
+//------------------------------------------------------------------------------
+inline void SparseBranchAndBound::evaluateLeaf(const std::size_t depth, const std::size_t numGrpOneCarrying)
+{
+  // *
+  // * A pattern contained in a cut was already covered by that cut's sparse
+  // * problem
+  // *
+  for (std::size_t c = 0; c < numCutMasks; ++c)
+  {
+    const std::uint64_t *cutMask = &cutMasks[c * candWords];
+    bool contained = true;
+    for (std::size_t w = 0; w < candWords && contained; ++w)
+      contained = !(chosenMask[w] & ~cutMask[w]);
+    if (contained)
+      return;
+  }
+
+  const std::uint64_t *two = &grpTwoCarriers[depth * indivWords];
+  std::size_t numGrpTwoCarrying = 0;
+  for (std::size_t w = 0; w < indivWords; ++w)
+    numGrpTwoCarrying += StateMatrix::popcount(two[w]);
+
+  const double objValue = objective(numGrpOneCarrying, numGrpTwoCarrying);
+  if (objValue < threshold || objValue <= 0)
+    return;
+  if (!enumerate && !solutions.empty() && objValue <= solutions.front().objValue)
+    return;
+
+  std::vector<std::size_t> pattern(forced);
+  for (std::size_t d = 0; d < depth; ++d)
+    pattern.push_back(candidates[chosen[d]]);
+  std::sort(std::begin(pattern), std::end(pattern));
+
+  if (!enumerate)
+    solutions.clear();
+  solutions.push_back(Solution(pattern, objValue));
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of search nodes created by the last call to solve()
+//------------------------------------------------------------------------------
+std::size_t SparseBranchAndBound::getNumNodes() const
+{
+  return nodes;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the objective value of a pattern carried by the given numbers of free
+// group one and group two individuals. Individuals fixed to 1 always count.
+//------------------------------------------------------------------------------
+inline double SparseBranchAndBound::objective(const std::size_t numGrpOneCarrying,
+                                              const std::size_t numGrpTwoCarrying) const
+{
+  return (numGrpOneFixedToOne + numGrpOneCarrying) / static_cast<double>(data->numGrpOne)
+       - (numGrpTwoFixedToOne + numGrpTwoCarrying) / static_cast<double>(data->numGrpTwo);
+}
+
+
+//------------------------------------------------------------------------------
+// Returns true if no pattern below a node with the given upper bound can be
+// recorded
+//------------------------------------------------------------------------------
+inline bool SparseBranchAndBound::prune(const double bound) const
+{
+  if (bound < threshold || bound <= 0)
+    return true;
+
+  return !enumerate && !solutions.empty() && bound <= solutions.front().objValue;
+}
+
+
+//------------------------------------------------------------------------------
+// Raises the threshold to the shared lower bound, if it has improved since the
+// problem was sent
+//------------------------------------------------------------------------------
+inline void SparseBranchAndBound::readSharedLowerBound()
+{
+  if (sharedLb != NULL && !enumerate)
+    threshold = std::max(threshold, sharedLb->load(std::memory_order_relaxed) - data->TOL);
+}
+
+
+//------------------------------------------------------------------------------
+// Sets a lower bound that another thread may raise while a problem is being
+// solved. The search reads it every few thousand nodes.
+//------------------------------------------------------------------------------
+void SparseBranchAndBound::setSharedLowerBound(const std::atomic<double> *_sharedLb)
+{
+  sharedLb = _sharedLb;
+}
+
+
+//------------------------------------------------------------------------------
+// Chooses the candidate for the given depth from the candidates at or after
+// start. Adding states can only remove carriers, so the group one carriers of
+// a node bound the group one term of every pattern below it, and the group two
+// term is bounded by the group two individuals fixed to 1.
+//------------------------------------------------------------------------------
+void SparseBranchAndBound::search(const std::size_t depth, const std::size_t start)
+{
+  const std::uint64_t *prevOne = &grpOneCarriers[depth * indivWords];
+  const std::uint64_t *prevTwo = &grpTwoCarriers[depth * indivWords];
+
+  if (depth == numToChoose)
+  {
+    std::size_t numGrpOneCarrying = 0;
+    for (std::size_t w = 0; w < indivWords; ++w)
+      numGrpOneCarrying += StateMatrix::popcount(prevOne[w]);
+    evaluateLeaf(depth, numGrpOneCarrying);
+    return;
+  }
+
+  std::uint64_t *one = &grpOneCarriers[(depth + 1) * indivWords];
+  std::uint64_t *two = &grpTwoCarriers[(depth + 1) * indivWords];
+  const std::size_t remaining = numToChoose - depth;
+
+  for (std::size_t p = start; p + remaining <= candidates.size(); ++p)
+  {
+    // Candidates are sorted by coverage, so no later candidate can do better
+    if (prune(objective(coverage[p], 0)))
+      break;
+
+    if (++nodes % 4096 == 0)
+      readSharedLowerBound();
+
+    const std::uint64_t *row = &grpOneRows[p * indivWords];
+    std::size_t numGrpOneCarrying = 0;
+    for (std::size_t w = 0; w < indivWords; ++w)
+    {
+      one[w] = prevOne[w] & row[w];
+      numGrpOneCarrying += StateMatrix::popcount(one[w]);
+    }
+
+    if (prune(objective(numGrpOneCarrying, 0)))
+      continue;
+
+    row = &grpTwoRows[p * indivWords];
+    for (std::size_t w = 0; w < indivWords; ++w)
+      two[w] = prevTwo[w] & row[w];
+
+    chosen[depth] = p;
+    StateMatrix::setBit(&chosenMask, p);
+    search(depth + 1, p + 1);
+    chosenMask[p >> 6] &= ~(std::uint64_t(1) << (p & 63));
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Builds the candidate rows and cut masks for a sparse problem. Returns false
+// if the problem has no feasible pattern.
+//------------------------------------------------------------------------------
+bool SparseBranchAndBound::setUp(const Cut &cutToSolve,
+                                 const std::vector<Cut> &cutSet,
+                                 const std::vector<std::size_t> &markVals,
+                                 const std::vector<std::size_t> &indVals)
+{
+  candidates.clear();
+  forced.clear();
+  coverage.clear();
+  numCutMasks = 0;
+  numGrpOneFixedToOne = 0;
+  numGrpTwoFixedToOne = 0;
+
+  // *
+  // * Individuals set to 0 never count, individuals set to 1 always count, and
+  // * the rest (including those set equal to another individual with the same
+  // * states) count if they carry the pattern
+  // *
+  std::vector<std::uint64_t> freeGrpOne(indivWords, 0);
+  std::vector<std::uint64_t> freeGrpTwo(indivWords, 0);
+  for (std::size_t j = 0; j < data->numIndiv; ++j)
+  {
+    const bool grpOne = (j >= data->grpOneStart && j <= data->grpOneEnd);
+    if (indVals[j] == 1)
+      ++(grpOne ? numGrpOneFixedToOne : numGrpTwoFixedToOne);
+    else if (indVals[j] != 0)
+      StateMatrix::setBit(grpOne ? &freeGrpOne : &freeGrpTwo, j);
+  }
+
+  // *
+  // * States forced to 1 are in every pattern, states forced to 0 in none
+  // *
+  const std::vector<std::size_t> &cutElements = cutToSolve.getTrueElements();
+  for (auto it = std::begin(cutElements); it != std::end(cutElements); ++it)
+  {
+    if (markVals[*it] == 1)
+      forced.push_back(*it);
+    else if (markVals[*it] == 2)
+      candidates.push_back(*it);
+  }
+
+  if (forced.size() > data->setSize)
+    return false;
+  numToChoose = data->setSize - forced.size();
+  if (candidates.size() < numToChoose)
+    return false;
+
+  grpOneCarriers.assign((numToChoose + 1) * indivWords, 0);
+  grpTwoCarriers.assign((numToChoose + 1) * indivWords, 0);
+  std::copy(std::begin(freeGrpOne), std::end(freeGrpOne), std::begin(grpOneCarriers));
+  std::copy(std::begin(freeGrpTwo), std::end(freeGrpTwo), std::begin(grpTwoCarriers));
+  for (auto it = std::begin(forced); it != std::end(forced); ++it)
+  {
+    const std::uint64_t *row = data->exprs.stateRow(*it);
+    for (std::size_t w = 0; w < indivWords; ++w)
+    {
+      grpOneCarriers[w] &= row[w];
+      grpTwoCarriers[w] &= row[w];
+    }
+  }
+
+  // *
+  // * Sort the candidates by the number of group one individuals carrying them
+  // * along with the forced states
+  // *
+  std::vector<std::pair<std::size_t, std::size_t> > order; // (coverage, state)
+  order.reserve(candidates.size());
+  for (auto it = std::begin(candidates); it != std::end(candidates); ++it)
+  {
+    const std::uint64_t *row = data->exprs.stateRow(*it);
+    std::size_t count = 0;
+    for (std::size_t w = 0; w < indivWords; ++w)
+      count += StateMatrix::popcount(row[w] & grpOneCarriers[w]);
+    order.push_back(std::make_pair(count, *it));
+  }
+  std::stable_sort(std::begin(order), std::end(order),
+                   [](const std::pair<std::size_t, std::size_t> &lhs,
+                      const std::pair<std::size_t, std::size_t> &rhs) { return lhs.first > rhs.first; });
+
+  candWords = StateMatrix::numWords(candidates.size());
+  grpOneRows.assign(candidates.size() * indivWords, 0);
+  grpTwoRows.assign(candidates.size() * indivWords, 0);
+  for (std::size_t p = 0; p < order.size(); ++p)
+  {
+    candidates[p] = order[p].second;
+    coverage.push_back(order[p].first);
+
+    const std::uint64_t *row = data->exprs.stateRow(candidates[p]);
+    for (std::size_t w = 0; w < indivWords; ++w)
+    {
+      grpOneRows[p * indivWords + w] = row[w] & grpOneCarriers[w];
+      grpTwoRows[p * indivWords + w] = row[w] & grpTwoCarriers[w];
+    }
+  }
+
+  // *
+  // * Only cuts containing every forced state and at least numToChoose
+  // * candidates can contain a pattern
+  // *
+  std::vector<std::size_t> position(data->numStates, candidates.size());
+  for (std::size_t p = 0; p < candidates.size(); ++p)
+    position[candidates[p]] = p;
+
+  cutMasks.clear();
+  for (auto it = std::begin(cutSet); it != std::end(cutSet); ++it)
+  {
+    bool containsForced = true;
+    for (auto f = std::begin(forced); f != std::end(forced) && containsForced; ++f)
+      containsForced = (*it)[*f];
+    if (!containsForced)
+      continue;
+
+    std::vector<std::uint64_t> mask(candWords, 0);
+    std::size_t count = 0;
+    const std::vector<std::size_t> &elements = it->getTrueElements();
+    for (auto e = std::begin(elements); e != std::end(elements); ++e)
+    {
+      if (position[*e] < candidates.size())
+      {
+        StateMatrix::setBit(&mask, position[*e]);
+        ++count;
+      }
+    }
+
+    if (count >= numToChoose)
+    {
+      cutMasks.insert(std::end(cutMasks), std::begin(mask), std::end(mask));
+      ++numCutMasks;
+    }
+  }
+
+  chosen.assign(numToChoose, 0);
+  chosenMask.assign(candWords, 0);
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Solves the sparse problem: choose setSize states of the cut to solve (those
+// not forced to 0, including every state forced to 1) that are not all within
+// one cut of the cut set, maximizing the objective. Returns the optimal
+// pattern, or every pattern with objective value >= threshold if enumerate is
+// true. Patterns must have a positive objective value at or above threshold.
+//------------------------------------------------------------------------------
+std::vector<Solution> SparseBranchAndBound::solve(const Cut &cutToSolve,
+                                                  const std::vector<Cut> &cutSet,
+                                                  const std::vector<std::size_t> &markVals,
+                                                  const std::vector<std::size_t> &indVals,
+                                                  const double _threshold,
+                                                  const bool _enumerate)
+{
+  assert(markVals.size() == data->numStates && indVals.size() == data->numIndiv);
+
+  threshold = _threshold - data->TOL; // so patterns exactly at the threshold survive rounding
+  enumerate = _enumerate;
+  nodes = 0;
+  solutions.clear();
+  readSharedLowerBound();
+
+  if (setUp(cutToSolve, cutSet, markVals, indVals))
+    search(0, 0);
+
+  return solutions;
+}
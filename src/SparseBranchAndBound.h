@@ -0,0 +1,72 @@
+// *
+// * Combinatorial branch and bound for the sparse problem, used in place of
+// * CPLEX when SPARSE_SOLVER is NATIVE. Patterns are built by a depth-first
+// * search over the states of the cut to solve. Each node keeps the bitsets of
+// * the group one and group two individuals carrying every state chosen so far,
+// * so a node's objective (and the bound on its children) is a popcount.
+// *
+
+#ifndef SPARSE_BRANCH_AND_BOUND_H
+#define SPARSE_BRANCH_AND_BOUND_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "Cut.h"
+#include "CSFS_Data.h"
+#include "Solution.h"
+
+class SparseBranchAndBound
+{
+  private:
+    const CSFS_Data *data;
+
+    std::size_t indivWords;                 // words in a row over individuals
+    std::size_t candWords;                  // words in a row over candidates
+    std::size_t numToChoose;                // states still to choose after the forced ones
+    std::vector<std::size_t> candidates;    // states that may be chosen, best group one coverage first
+    std::vector<std::size_t> forced;        // states forced into every pattern
+    std::vector<std::size_t> coverage;      // group one individuals carrying each candidate
+    std::vector<std::uint64_t> grpOneRows;  // free group one individuals carrying each candidate
+    std::vector<std::uint64_t> grpTwoRows;  // free group two individuals carrying each candidate
+    std::vector<std::uint64_t> cutMasks;    // candidates in each cut that could hold a pattern
+    std::size_t numCutMasks;
+    std::size_t numGrpOneFixedToOne;
+    std::size_t numGrpTwoFixedToOne;
+
+    double threshold;
+    bool enumerate;
+    const std::atomic<double> *sharedLb; // raised while a problem is solved, or NULL
+
+    std::vector<std::uint64_t> grpOneCarriers; // one row for each depth of the search
+    std::vector<std::uint64_t> grpTwoCarriers;
+    std::vector<std::size_t> chosen;
+    std::vector<std::uint64_t> chosenMask;
+    std::vector<Solution> solutions;
+
+    std::size_t nodes;
+
+    void evaluateLeaf(const std::size_t, const std::size_t);
+    double objective(const std::size_t, const std::size_t) const;
+    bool prune(const double) const;
+    void readSharedLowerBound();
+    void search(const std::size_t, const std::size_t);
+    bool setUp(const Cut &,
+               const std::vector<Cut> &,
+               const std::vector<std::size_t> &,
+               const std::vector<std::size_t> &);
+
+  public:
+    SparseBranchAndBound(const CSFS_Data &);
+    std::size_t getNumNodes() const;
+    void setSharedLowerBound(const std::atomic<double> *);
+    std::vector<Solution> solve(const Cut &,
+                                const std::vector<Cut> &,
+                                const std::vector<std::size_t> &,
+                                const std::vector<std::size_t> &,
+                                const double,
+                                const bool);
+};
+
+#endif
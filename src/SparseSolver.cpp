@@ -1,6 +1,38 @@
 #include "SparseSolver.h"
 #include "CSFS_Utils.h"
+#include <algorithm>
 #include <cassert>
+
+namespace
+{
+  // *
+  // * Prunes the branch and bound nodes whose relaxation is below the lower
+  // * bound shared by the worker, which may have improved since the sparse
+  // * problem was sent
+  // *
+  class SharedLowerBoundCallbackI : public IloCplex::BranchCallbackI
+  {
+    private:
+      const std::atomic<double> *sharedLb;
+      const double tol;
+
+    public:
+      SharedLowerBoundCallbackI(IloEnv env, const std::atomic<double> *_sharedLb, const double _tol)
+        : IloCplex::BranchCallbackI(env), sharedLb(_sharedLb), tol(_tol) {}
+
+      IloCplex::CallbackI *duplicateCallback() const
+      {
+        return new (getEnv()) SharedLowerBoundCallbackI(*this);
+      }
+
+      void main()
+      {
+        if (getObjValue() < sharedLb->load(std::memory_order_relaxed) - tol)
+          prune();
+      }
+  };
+}
+
 //------------------------------------------------------------------------------
 //    Constructor
 //------------------------------------------------------------------------------
@@ -16,9 +48,177 @@ SparseSolver::SparseSolver(const CSFS_Data &_data) : data(&_data),
                                                     numGrpTwoFullCutToSolve(0),
                                                     objValue(0),
                                                     solutionPool(0),
-                                                    pattern(data->numStates),
-                                                    threshold(0)
-{}
+                                                    pattern(0),
+                                                    threshold(0),
+                                                    sharedLb(NULL),
+                                                    numFreeMarkers(0),
+                                                    numFreeIndividuals(0),
+                                                    env(NULL),
+                                                    indivConstraints(0),
+                                                    indivEqualityConstraints(0),
+                                                    columnOf(data->numStates, data->numStates),
+                                                    stateOfColumn(0),
+                                                    modelMarkLb(0),
+                                                    modelMarkUb(0),
+                                                    modelIndVals(data->numIndiv, 2),
+                                                    modelIndivEquals(data->numIndiv, data->numIndiv),
+                                                    branchAndBound(_data),
+                                                    timer(false, true)
+{
+  // The native solver needs no CPLEX environment, model (or license)
+  if (data->USE_NATIVE_SPARSE_SOLVER)
+    return;
+
+  env = IloEnv();
+  cplex = IloCplex(env);
+  model = IloModel(env);
+  mark = IloNumVarArray(env);
+  indiv = IloNumVarArray(env, data->numIndiv, 0, 1, ILOINT);
+  markCopy = IloNumArray(env);
+  obj = IloExpr(env);
+  indivConstraints.resize(data->numIndiv);
+  indivEqualityConstraints.resize(data->numIndiv);
+
+  indiv.setNames("i");
+
+  buildModel();
+
+  cplex.extract(model);
+  cplex.setParam(IloCplex::Param::Threads, 1);
+  cplex.setParam(IloCplex::Param::RandomSeed, data->CPLEX_SEED);
+  if (data->USE_SOLUTION_POOL_THRESHOLD)
+  {
+    cplex.setParam(IloCplex::Param::MIP::Pool::Replace, CPX_SOLNPOOL_DIV);
+    cplex.setParam(IloCplex::Param::MIP::Pool::Intensity, 4);
+    cplex.setParam(IloCplex::Param::MIP::Limits::Populate, 100000);
+  }
+  if (!data->PRINT_CPLEX_OUTPUT)
+    cplex.setOut(env.getNullStream());
+}
+
+
+//------------------------------------------------------------------------------
+// Adds a column to the model for marker state i, with its coefficients in the
+// pattern size constraint, the constraints of the individuals carrying it and
+// the cuts containing it. It starts bounded to 0, like a state without one.
+//------------------------------------------------------------------------------
+void SparseSolver::addColumn(const std::size_t i)
+{
+  IloNumVar column(env, 0, 0, ILOINT);
+  column.setName(("m" + std::to_string(i)).c_str());
+
+  columnOf[i] = stateOfColumn.size();
+  stateOfColumn.push_back(i);
+  mark.add(column);
+  markCopy.add(0);
+  modelMarkLb.push_back(0);
+  modelMarkUb.push_back(0);
+
+  markSummation.setLinearCoef(column, 1);
+  data->exprs.forEachCarrier(i, [&](const std::size_t j) {
+    const bool grpOne = (j >= data->grpOneStart && j <= data->grpOneEnd);
+    indivConstraints[j].setLinearCoef(column, grpOne ? -1.0 / data->setSize : -1.0);
+  });
+  for (auto it = std::begin(cutConstraints); it != std::end(cutConstraints); ++it)
+  {
+    if (it->first[i])
+      it->second.setLinearCoef(column, 1);
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Gives CPLEX the best pattern of the previous sparse problem as a MIP start,
+// if it is still feasible with respect to the marker bounds and cuts of this
+// sparse problem. Only the markers are given; CPLEX completes the individuals.
+//------------------------------------------------------------------------------
+void SparseSolver::addMIPStart()
+{
+  if (cplex.getNMIPStarts() > 0)
+    cplex.deleteMIPStarts(0, cplex.getNMIPStarts());
+
+  if (incumbent.size() != data->setSize)
+    return;
+
+  std::size_t numFixedToOne = 0;
+  for (std::size_t c = 0; c < stateOfColumn.size(); ++c)
+    numFixedToOne += modelMarkLb[c];
+
+  std::size_t numFixedToOneInIncumbent = 0;
+  for (auto it = std::begin(incumbent); it != std::end(incumbent); ++it)
+  {
+    const std::size_t c = columnOf[*it];
+    if (c == data->numStates || !modelMarkUb[c])
+      return;
+    numFixedToOneInIncumbent += modelMarkLb[c];
+  }
+  if (numFixedToOneInIncumbent != numFixedToOne)
+    return;
+
+  for (auto it = std::begin(cutConstraints); it != std::end(cutConstraints); ++it)
+  {
+    std::size_t numInCut = 0;
+    for (auto i = std::begin(incumbent); i != std::end(incumbent); ++i)
+      numInCut += it->first[*i];
+    if (numInCut > data->setSize - 1)
+      return;
+  }
+
+  IloNumArray startVals(env, mark.getSize());
+  for (IloInt c = 0; c < mark.getSize(); ++c)
+    startVals[c] = 0;
+  for (auto it = std::begin(incumbent); it != std::end(incumbent); ++it)
+    startVals[columnOf[*it]] = 1;
+
+  cplex.addMIPStart(mark, startVals, IloCplex::MIPStartSolveMIP);
+  startVals.end();
+}
+
+
+//------------------------------------------------------------------------------
+// Adds the objective function and the constraints that do not change between
+// sparse problems to the model. The markers are added by addColumn() once
+// their state is in a cut to solve, and are bounded to 0 while it isn't, so
+// the constraints start without them.
+//------------------------------------------------------------------------------
+void SparseSolver::buildModel()
+{
+  // *
+  // * Add objective function
+  // *
+  for (std::size_t j = data->grpOneStart; j <= data->grpOneEnd; ++j)
+    obj += indiv[j] / static_cast<IloNum>(data->numGrpOne);
+  for (std::size_t j = data->grpTwoStart; j <= data->grpTwoEnd; ++j)
+    obj -= indiv[j] / static_cast<IloNum>(data->numGrpTwo);
+
+  model.add(IloMaximize(env, obj, "Objective"));
+
+  // *
+  // * The sum of the markers in the pattern must equal setSize.
+  // *
+  markSummation = IloRange(env, data->setSize, data->setSize, "MarkSummation");
+  model.add(markSummation);
+
+  // *
+  // * An individual can only be 1 if they carry the full pattern.
+  // * An individual cannot be zero if they carry the full pattern.
+  // * These are relaxed (by moving a bound to infinity) while the individual
+  // * is fixed or set equal to another individual.
+  // *
+  for (std::size_t j = data->grpOneStart; j <= data->grpOneEnd; ++j)
+  {
+    indivConstraints[j] = IloRange(env, -IloInfinity, indiv[j], 0);
+    model.add(indivConstraints[j]);
+  }
+  for (std::size_t j = data->grpTwoStart; j <= data->grpTwoEnd; ++j)
+  {
+    indivConstraints[j] = IloRange(env, 1.0 - data->setSize, indiv[j], IloInfinity);
+    model.add(indivConstraints[j]);
+  }
+
+  if (data->USE_SOLUTION_POOL_THRESHOLD)
+    model.add(IloConstraint(obj >= data->SOLUTION_POOL_THRESHOLD));
+}
 
 //------------------------------------------------------------------------------
 //    Updates the cut to solce
@@ -71,24 +271,50 @@ void SparseSolver::setThreshold(const double val)
 }
 
 
+//------------------------------------------------------------------------------
+// Sets a lower bound that the worker may raise while a problem is being
+// solved. It is applied when a solve starts, and during the search by the
+// native solver's pruning or a CPLEX branch callback. Solution pools keep
+// the threshold they were sent with.
+//------------------------------------------------------------------------------
+void SparseSolver::setSharedLowerBound(const std::atomic<double> *_sharedLb)
+{
+  sharedLb = _sharedLb;
+  branchAndBound.setSharedLowerBound(_sharedLb);
+
+  if (!data->USE_NATIVE_SPARSE_SOLVER && !data->USE_SOLUTION_POOL_THRESHOLD)
+    cplex.use(IloCplex::Callback(new (env) SharedLowerBoundCallbackI(env, sharedLb, data->TOL)));
+}
+
+
 //------------------------------------------------------------------------------
 //   Counts the number of non-zero marker states each individual has that 
 //	 matches the cut to solve
 //------------------------------------------------------------------------------
 void SparseSolver::countNumberOfMarkersInCutToSOlve()
 {
-  std::vector<std::size_t> cut_elements = cutToSolve.getTrueElements();
-  
+  const std::vector<std::uint64_t> remainingCutStates = getRemainingCutStates();
+
   for(std::size_t j = 0; j < data->numIndiv; ++j)
+    numMarkersInCutToSolve[j] = data->exprs.countStates(j, remainingCutStates);
+}
+
+//------------------------------------------------------------------------------
+//   Returns a mask of the marker states in the cut to solve that haven't been
+//   forced to 0
+//------------------------------------------------------------------------------
+std::vector<std::uint64_t> SparseSolver::getRemainingCutStates() const
+{
+  std::vector<std::uint64_t> mask(data->exprs.indivRowWords(), 0);
+  std::vector<std::size_t> cut_elements = cutToSolve.getTrueElements();
+
+  for(auto it = std::begin(cut_elements); it != std::end(cut_elements); ++it)
   {
-    numMarkersInCutToSolve[j] = 0;
-	
-	  for(auto it = std::begin(cut_elements); it != std::end(cut_elements); ++it)
-	  {
-		  if(data->exprs[*it][j] && markVals[*it]!= 0)
-			  ++numMarkersInCutToSolve[j];
-	  }
+    if(markVals[*it] != 0)
+      StateMatrix::setBit(&mask, *it);
   }
+
+  return mask;
 }
 
 //------------------------------------------------------------------------------
@@ -146,18 +372,20 @@ bool SparseSolver::setMarkersToZero()
   std::size_t num_markers_set = 0;
   
   std::vector<std::size_t> cut_elements = cutToSolve.getTrueElements();
+
+  // Mask of the group one individuals that haven't been forced to 0
+  std::vector<std::uint64_t> remainingGrpOne(data->exprs.stateRowWords(), 0);
+  for (size_t j = data->grpOneStart; j <= data->grpOneEnd; ++j)
+  {
+    if(indVals[j] != 0)
+      StateMatrix::setBit(&remainingGrpOne, j);
+  }
   
   for(auto it = std::begin(cut_elements); it != std::end(cut_elements); ++it) // Loop through all markers in cut
   {
     if(markVals[*it] == 2) // Check that marker is not already set
     {
-      numGrpOneCarrying[*it] = 0; // Reset counter
-      
-      for (size_t j = data->grpOneStart; j <= data->grpOneEnd; ++j) // Loop through all group 1
-      {
-        if(data->exprs[*it][j] && indVals[j] != 0)
-          ++numGrpOneCarrying[*it];
-      }
+      numGrpOneCarrying[*it] = data->exprs.countCarrying(*it, remainingGrpOne);
       
       double upperLimit = numGrpOneCarrying[*it]/static_cast<double>(data->numGrpOne) - numGrpTwoFullCutToSolve / static_cast<double>(data->numGrpTwo);
       
@@ -184,89 +412,32 @@ bool SparseSolver::setMarkersToZero()
 bool SparseSolver::setIndividualEqualityConstraints()
 {
   std::size_t num_eqaulities_set = 0;
-  std::vector<std::size_t> cut_elements = cutToSolve.getTrueElements();
-  std::vector<std::pair<std::size_t, std::size_t>> individuals_copy;
-  std::vector<std::pair<std::size_t, std::size_t> > groups;
-  
+  const std::vector<std::uint64_t> remainingCutStates = getRemainingCutStates();
+  std::vector<std::size_t> unsetIndividuals;
+
   for(std::size_t j = 0; j < data->numIndiv; ++j)
   {
     if(indVals[j] == 2)
-      individuals_copy.emplace_back(std::make_pair(j, numMarkersInCutToSolve[j]));
+      unsetIndividuals.push_back(j);
   }
-  std::sort(std::begin(individuals_copy), std::end(individuals_copy), CSFSUtils::SortPairBySecondItemIncreasing());
-    
+
   // *
-  // * Find the start and end indexes for all groups of individuals that have
-  // * the same number of remaining markers
+  // * Make every individual equal to the first one with the same remaining
+  // * marker states in the cut to solve
   // *
-  for (std::size_t i = 0; i < individuals_copy.size() - 1;)
-  {
-    std::size_t j = i + 1;
-    while (j < individuals_copy.size())
-    {
-      if (individuals_copy[i].second != individuals_copy[j].second)
-      {
-        if (j-1 != i)
-          groups.emplace_back(std::make_pair(i, j-1));
-        break;
-      }
-      else if (j == individuals_copy.size() - 1)
-      {
-        groups.emplace_back(std::make_pair(i, j));
-      }
-      ++j;
-    }
-    i = j;
-  }
-  
+  const std::vector<std::vector<std::size_t> > groups = data->exprs.groupSameStates(unsetIndividuals, remainingCutStates);
   for (auto it = std::begin(groups); it != std::end(groups); ++it)
   {
-    const std::size_t start = it->first;
-    const std::size_t end = it->second;
-
-    for (std::size_t index1 = start; index1 <= end - 1; ++index1)
+    const std::size_t x = it->front();
+    for (auto y = std::next(std::begin(*it)); y != std::end(*it); ++y)
     {
-      std::size_t x = individuals_copy[index1].first;
-      for (std::size_t index2 = index1+1; index2 <= end; ++index2)
-      {
-        std::size_t y = individuals_copy[index2].first;
-
-        // *
-        // * Check if individuals x or y already have an
-        // * equality constraint
-        // *
-        if ((indVals[x] != 2) || (indVals[y] != 2))
-          continue;
-
-        // *
-        // * Check if individual x and y's remaining markers are equal
-        // *
-        {
-          bool match = true;
-          for(auto it2 = std::begin(cut_elements); it2 != std::end(cut_elements); ++it2)
-          {
-            if((markVals[*it2] != 0) && (data->exprs[*it2][x] != data->exprs[*it2][y]))
-            {
-              match = false;
-              break;
-            }
-          }
-           
-          // *
-          // * If individual x and y's remaining markers are equal
-          // *
-          if (match)
-          {
-            indVals[y] = 3;
-            indivEquals[y] = x;
-            ++num_eqaulities_set;
+      indVals[*y] = 3;
+      indivEquals[*y] = x;
+      ++num_eqaulities_set;
 
-            #ifndef NDEBUG
-              std::cout << "Forcing individual_" << y << " to equal individual_" << x << std::endl;
-            #endif
-          }
-        }
-      }
+      #ifndef NDEBUG
+        std::cout << "Forcing individual_" << *y << " to equal individual_" << x << std::endl;
+      #endif
     }
   }
   
@@ -279,213 +450,67 @@ void SparseSolver::solve()
 {
   std::vector<Solution>().swap( solutionPool ); // Reset container
   objValue = 0;
+
+  if (sharedLb != NULL && !data->USE_SOLUTION_POOL_THRESHOLD)
+    threshold = std::max(threshold, sharedLb->load());
     
   if(data->USE_SPARSE_CONTRAINTS)
   {
     countNumberOfMarkersInCutToSOlve();
     setIndividualsToZeroOrOne();
   }
-  solveMIP(cutToSolve); 
+
+  // *
+  // * Size of the problem left after the reductions
+  // *
+  numFreeMarkers = 0;
+  const std::vector<std::size_t> &cutElements = cutToSolve.getTrueElements();
+  for (auto it = std::begin(cutElements); it != std::end(cutElements); ++it)
+  {
+    if (markVals[*it] != 0)
+      ++numFreeMarkers;
+  }
+  numFreeIndividuals = std::count(std::begin(indVals), std::end(indVals), 2);
+
+  if (data->USE_NATIVE_SPARSE_SOLVER)
+    solveNative();
+  else
+    solveMIP(cutToSolve); 
    
   std::vector<Cut>().swap( cutSet ); // Reset container  
 }
 
 //------------------------------------------------------------------------------
-// Update the model, solve the relaxation, and get the objective and variable
-// values
+// Update the model, solve the sparse problem, and get the objective and
+// variable values
 //------------------------------------------------------------------------------
 void SparseSolver::solveMIP(const Cut& mipCutToSolve)
 {  
-  // Get number of marks and individuals for sparse problem
-  const std::size_t numMarks = cutToSolve.size();
-    
-  IloEnv env;
   try {
     // DEBUG
     if (data->VERBOSE)
       std::cout << "Sparse Solver solv() Starting" << std::endl;
-  
-    IloModel model(env);
-    IloCplex cplex(env);
-    IloNumVarArray mark(env, numMarks, 0, 1, ILOINT);
-    IloNumArray markCopy(env, numMarks, 0, 1);
-    
-    IloNumVarArray indiv(env, data->numIndiv, 0, 1, ILOINT);
-  
-    IloExpr obj(env);
-    IloConstraintArray userConstraints(env);  
-
-    mark.setNames("m");
-    indiv.setNames("i");
-  
-    if (data->VERBOSE)
-      std::cout << "Declared CPLEX variables" << std::endl;
-
-
-    std::vector<std::size_t> origToSparse(data->numStates, data->numStates);
-    std::vector<std::size_t> sparseToOrig = cutToSolve.getTrueElements();
-    for(std::size_t i = 0; i < sparseToOrig.size(); ++i)
-      origToSparse[sparseToOrig[i]] = i;
-
-    // *
-    // * Add objective function
-    // *
-    for (std::size_t j = data->grpOneStart; j <= data->grpOneEnd; ++j)
-    {
-      obj += indiv[j] / static_cast<IloNum>(data->numGrpOne);
-    }
-      
-    for (std::size_t j = data->grpTwoStart; j <= data->grpTwoEnd; ++j)
-    {
-      obj -= indiv[j] / static_cast<IloNum>(data->numGrpTwo);
-    }      
-    
-    if (data->VERBOSE)    
-      std::cout << "Created Objective Function" << std::endl;
-  
-    model.add(IloMaximize(env, obj, "Objective"));
-  
-    if (data->VERBOSE)
-      std::cout << "Added Objective Function" << std::endl;
-     
-    IloExpr markSummationExpr(env);
-    for (std::size_t i = 0; i < numMarks; ++i)
-      markSummationExpr += mark[i];    
-    IloConstraint markSummation(markSummationExpr == data->setSize);
-    markSummation.setName("MarkSummation");
-    userConstraints.add(markSummation);
-    markSummationExpr.end();
-    if (data->VERBOSE)
-    std::cout << "Added Pattern Size Constraint" << std::endl;
-
 
     // *
-    // * Add constraints for each individual
+    // * Apply the differences from the previous sparse problem
     // *
-    for (size_t j = data->grpOneStart; j <= data->grpOneEnd; ++j)
-    {
-      if(indVals[j] == 0) {
-        // DEBUG        
-        IloConstraint indivConst(indiv[j] == 0);
-        userConstraints.add(indivConst);
-      } else if (indVals[j] == 1) {
-        IloConstraint indivConst(indiv[j] == 1);
-        userConstraints.add(indivConst);
-      } else if (indVals[j] == 3) { // Indivudal set to another individual
-        IloConstraint indivConst(indiv[j] == indiv[indivEquals[j]]);
-        userConstraints.add(indivConst);
-      }
-      else if (indVals[j] == 2) // Default
-      {
-        IloExpr gij_marki(env);
-        for(std::size_t i = 0; i < data->numStates; ++i)
-        {
-          if (cutToSolve[i])
-            gij_marki += mark[origToSparse[i]] * data->exprs[i][j];
-        }
-        IloConstraint indivConst(indiv[j] <= gij_marki / data->setSize);
-        userConstraints.add(indivConst);
-        gij_marki.end();
-      }
-    }
-    for (size_t j = data->grpTwoStart; j <= data->grpTwoEnd; ++j)
-    {
-      if (indVals[j] == 0)
-      {
-        IloConstraint indivConst(indiv[j] == 0);
-        userConstraints.add(indivConst);
-      }
-      else if (indVals[j] == 1)
-      {
-        IloConstraint indivConst(indiv[j] == 1);
-        userConstraints.add(indivConst);
-      }
-      else if (indVals[j] == 3)
-      {
-        IloConstraint indivConst(indiv[j] == indiv[indivEquals[j]]);
-        userConstraints.add(indivConst);
-      }
-      else if (indVals[j] == 2)
-      {
-        IloExpr gij_marki(env);
-        for(std::size_t i = 0; i < data->numStates; ++i)
-        {
-          if(cutToSolve[i])
-            gij_marki += mark[origToSparse[i]] * data->exprs[i][j];
-        }
-        IloConstraint indivConst(indiv[j] >= gij_marki - data->setSize + 1);
-        userConstraints.add(indivConst);
-        gij_marki.end();
-      }
-    }
-    if (data->VERBOSE)
-      std::cout << "Added Individual Contraints" << std::endl;
-  
+    updateMarkers();
+    updateIndividuals();
+    updateCutConstraints();
+    addMIPStart();
 
-    // *
-    // * Add constraints for forced makers
-    // *
-    for(std::size_t i = 0; i < data->numStates; ++i)
-    {
-      // Check if marker is forced
-      if((markVals[i] != 2) && (cutToSolve[i]))
-      {
-        if(origToSparse[i] == numMarks)
-          printf("ERROR: Indexing mark out of bounds\n");
-        IloConstraint fixedMarkConstraint(mark[origToSparse[i]] == static_cast<IloInt>(markVals[i]));
-        fixedMarkConstraint.setName("FixedMark");
-        userConstraints.add(fixedMarkConstraint);      
-      }   
-    }
     if (data->VERBOSE)
-      std::cout << "Added Fixed Marker Contraints" << std::endl;
+      std::cout << "Updated the model" << std::endl;
 
     // *
-    // * Add constraints from cut set
+    // * Solutions left in the pool by the previous sparse problem may not be
+    // * feasible for this one
     // *
-    for(std::size_t i_cut = 0; i_cut < cutSet.size(); ++i_cut)
-    {
-      IloExpr cutExpr(env);
-      std::size_t numMarksInBothCuts = 0;
-      for(std::size_t i = 0; i < data->numStates; ++i)
-      {
-        if(cutSet[i_cut][i] && cutToSolve[i])
-        {
-          if(origToSparse[i] == numMarks)
-            printf("ERROR: Indexing mark out of bounds\n");
-
-          cutExpr += mark[origToSparse[i]];
-          ++numMarksInBothCuts;
-        }
-      }
-
-      if (numMarksInBothCuts > data->setSize-1)
-      {
-        IloConstraint cutConstraint(cutExpr <= static_cast<IloInt>(data->setSize-1));
-        cutConstraint.setName("Cut");
-        userConstraints.add(cutConstraint);
-      }
-      cutExpr.end();
-    }
-
-    if (data->VERBOSE)
-      std::cout << "Added Cuts Contraints" << std::endl;
-  
-    model.add(userConstraints);
-
-    if (!data->PRINT_CPLEX_OUTPUT)
-      cplex.setOut(env.getNullStream());
+    if (cplex.getSolnPoolNsolns() > 0)
+      cplex.delSolnPoolSolns(0, cplex.getSolnPoolNsolns() - 1);
 
     if(data->USE_SOLUTION_POOL_THRESHOLD)
     {
-      model.add(IloConstraint(obj >= data->SOLUTION_POOL_THRESHOLD));
-      cplex.extract(model);
-      cplex.setParam(IloCplex::Param::Threads, 1);
-      cplex.setParam(IloCplex::Param::RandomSeed, data->CPLEX_SEED);
-      cplex.setParam(IloCplex::Param::MIP::Pool::Replace, CPX_SOLNPOOL_DIV);
-      cplex.setParam(IloCplex::Param::MIP::Pool::Intensity, 4);
-      cplex.setParam(IloCplex::Param::MIP::Limits::Populate, 100000);
-            
       // *
       // * Enumerate all solutions
       // *
@@ -495,12 +520,8 @@ void SparseSolver::solveMIP(const Cut& mipCutToSolve)
     }
     else
     {
-      cplex.extract(model);
-      cplex.setParam(IloCplex::Param::Threads, 1);
-      cplex.setParam(IloCplex::Param::RandomSeed, data->CPLEX_SEED);
-
-      if(data->USE_LOWER_CUTOFF && threshold > 0)
-        cplex.setParam(IloCplex::Param::MIP::Tolerances::LowerCutoff, threshold);
+      if(data->USE_LOWER_CUTOFF)
+        cplex.setParam(IloCplex::Param::MIP::Tolerances::LowerCutoff, threshold > 0 ? threshold : -1e+75);
       
       // *
       // * Solve the sparse problem
@@ -508,6 +529,10 @@ void SparseSolver::solveMIP(const Cut& mipCutToSolve)
       timer.restart();
       cplex.solve();
       timer.stop();
+
+      // Solutions found before the bound was raised are no longer needed
+      if (sharedLb != NULL)
+        threshold = std::max(threshold, sharedLb->load());
     }
     
     
@@ -524,15 +549,12 @@ void SparseSolver::solveMIP(const Cut& mipCutToSolve)
       if (data->VERBOSE)
         std::cout << "Infeasible Solution" << std::endl;
       objValue = 0;
-
-      for (std::size_t i = 0; i < numMarks; ++i)
-        markCopy[i] = 0;
-      for (std::size_t i = 0; i < data->numStates; ++i)
-        pattern[i] = 0;
+      pattern.assign(mark.getSize(), 0);
     }
     else if (cplex.getStatus() == IloAlgorithm::Optimal)
     {
       int numSol = cplex.getSolnPoolNsolns();
+      double bestObjValue = 0;
             
       for (int i_sol = 0; i_sol < numSol; ++i_sol)
       {
@@ -542,10 +564,9 @@ void SparseSolver::solveMIP(const Cut& mipCutToSolve)
         {
           cplex.getValues(mark, markCopy, i_sol);
           
-          for(std::size_t i = 0; i < data->numStates; ++i)
-            pattern[i] = 0;            
-          for(std::size_t i = 0; i < numMarks; ++i)
-            pattern[sparseToOrig[i]] = markCopy[i];
+          pattern.resize(mark.getSize());
+          for(std::size_t c = 0; c < pattern.size(); ++c)
+            pattern[c] = markCopy[c];
 
           roundExtremeValues(&pattern);
           if (data->VERBOSE)
@@ -553,6 +574,12 @@ void SparseSolver::solveMIP(const Cut& mipCutToSolve)
         
           std::vector<std::size_t> sol_vect = getSolution();
 
+          if (incumbent.empty() || objValue > bestObjValue)
+          {
+            incumbent = sol_vect;
+            bestObjValue = objValue;
+          }
+
           // DEBUG
           if (data->VERBOSE)
             std::cout << "Output Model" << std::endl;
@@ -583,11 +610,6 @@ void SparseSolver::solveMIP(const Cut& mipCutToSolve)
       throw std::logic_error("Relaxation was not optimal");
     }
   
-    obj.end();
-    markSummation.end();
-    model.end();
-    cplex.end();
-  
     // DEBUG
     if (data->VERBOSE)
       std::cout << "Finished Sparse Solver" << std::endl;
@@ -598,10 +620,166 @@ void SparseSolver::solveMIP(const Cut& mipCutToSolve)
   catch (...) {
     std::cout << "Unknown exception caught" << std::endl;
   }
-  
-  env.end();
+}
+
+
+//------------------------------------------------------------------------------
+// Solves the sparse problem with the native branch and bound instead of CPLEX
+//------------------------------------------------------------------------------
+void SparseSolver::solveNative()
+{
+  timer.restart();
+  solutionPool = branchAndBound.solve(cutToSolve,
+                                      cutSet,
+                                      markVals,
+                                      indVals,
+                                      threshold,
+                                      data->USE_SOLUTION_POOL_THRESHOLD);
+  timer.stop();
+
+  for (auto it = std::begin(solutionPool); it != std::end(solutionPool); ++it)
+    objValue = std::max(objValue, it->objValue);
+
+  if (data->VERBOSE)
+    std::cout << "Branch and bound searched " << branchAndBound.getNumNodes() << " nodes and found "
+              << solutionPool.size() << " solutions above threshold." << std::endl;
+}
+
+
+//------------------------------------------------------------------------------
+// Adds a constraint for every cut in the cut set that is not yet in the model,
+// and removes the constraints of cuts that are no longer in the cut set (they
+// were subsumed or merged by the controller)
+//------------------------------------------------------------------------------
+void SparseSolver::updateCutConstraints()
+{
+  std::set<Cut> current(std::begin(cutSet), std::end(cutSet));
+
+  for (auto it = std::begin(cutConstraints); it != std::end(cutConstraints);)
+  {
+    if (current.find(it->first) == std::end(current))
+    {
+      model.remove(it->second);
+      it->second.end();
+      it = cutConstraints.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  for (auto it = std::begin(current); it != std::end(current); ++it)
+  {
+    if (cutConstraints.find(*it) != std::end(cutConstraints))
+      continue;
 
+    IloExpr cutExpr(env);
+    const std::vector<std::size_t> elements = it->getTrueElements();
+    for (auto i = std::begin(elements); i != std::end(elements); ++i)
+    {
+      if (columnOf[*i] < data->numStates)
+        cutExpr += mark[columnOf[*i]];
+    }
+
+    IloRange cutConstraint(env, -IloInfinity, cutExpr, static_cast<IloNum>(data->setSize - 1), "Cut");
+    model.add(cutConstraint);
+    cutConstraints.insert(std::make_pair(*it, cutConstraint));
+    cutExpr.end();
+  }
 }
+
+
+//------------------------------------------------------------------------------
+// Updates the bounds and constraints of every individual whose value (0, 1,
+// determined by the model, or equal to another individual) changed since the
+// previous sparse problem
+//------------------------------------------------------------------------------
+void SparseSolver::updateIndividuals()
+{
+  for (std::size_t j = 0; j < data->numIndiv; ++j)
+  {
+    const std::size_t equals = (indVals[j] == 3) ? indivEquals[j] : data->numIndiv;
+    if (indVals[j] == modelIndVals[j] && equals == modelIndivEquals[j])
+      continue;
+
+    const bool grpOne = (j >= data->grpOneStart && j <= data->grpOneEnd);
+
+    // *
+    // * Bounds
+    // *
+    if (indVals[j] == 0)
+      indiv[j].setBounds(0, 0);
+    else if (indVals[j] == 1)
+      indiv[j].setBounds(1, 1);
+    else
+      indiv[j].setBounds(0, 1);
+
+    // *
+    // * The constraint linking the individual to the markers only applies when
+    // * the individual is determined by the model
+    // *
+    if ((indVals[j] == 2) != (modelIndVals[j] == 2))
+    {
+      if (grpOne)
+        indivConstraints[j].setUB(indVals[j] == 2 ? 0 : IloInfinity);
+      else
+        indivConstraints[j].setLB(indVals[j] == 2 ? 1.0 - data->setSize : -IloInfinity);
+    }
+
+    // *
+    // * Equality with another individual
+    // *
+    if (equals != modelIndivEquals[j])
+    {
+      if (modelIndivEquals[j] < data->numIndiv)
+      {
+        model.remove(indivEqualityConstraints[j]);
+        indivEqualityConstraints[j].end();
+      }
+      if (equals < data->numIndiv)
+      {
+        indivEqualityConstraints[j] = IloRange(env, 0, indiv[j] - indiv[equals], 0, "IndivEquality");
+        model.add(indivEqualityConstraints[j]);
+      }
+    }
+
+    modelIndVals[j] = indVals[j];
+    modelIndivEquals[j] = equals;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Adds a column for every state of the cut to solve that hasn't been forced to
+// 0 and has none yet. Then bounds each marker to 0 if it is not in the cut to
+// solve or was forced to 0, to 1 if it is in the cut to solve and was forced
+// to 1, and to [0, 1] otherwise. Only markers whose bounds changed are
+// touched.
+//------------------------------------------------------------------------------
+void SparseSolver::updateMarkers()
+{
+  const std::vector<std::size_t> &cutElements = cutToSolve.getTrueElements();
+  for (auto it = std::begin(cutElements); it != std::end(cutElements); ++it)
+  {
+    if (markVals[*it] != 0 && columnOf[*it] == data->numStates)
+      addColumn(*it);
+  }
+
+  for (std::size_t c = 0; c < stateOfColumn.size(); ++c)
+  {
+    const std::size_t i = stateOfColumn[c];
+    const char lb = (cutToSolve[i] && markVals[i] == 1) ? 1 : 0;
+    const char ub = (cutToSolve[i] && markVals[i] != 0) ? 1 : 0;
+    if (lb == modelMarkLb[c] && ub == modelMarkUb[c])
+      continue;
+
+    mark[c].setBounds(lb, ub);
+    modelMarkLb[c] = lb;
+    modelMarkUb[c] = ub;
+  }
+}
+
     
 //------------------------------------------------------------------------------
 //    Returns the solution pool
@@ -627,17 +805,44 @@ double SparseSolver::getCpuTimeToSolve() const
   return timer.elapsed_cpu_time();
 }
 
+//------------------------------------------------------------------------------
+//    Returns the wall time needed to solve the last sparse problem
+//------------------------------------------------------------------------------
+double SparseSolver::getWallTimeToSolve() const
+{
+  return timer.elapsed_wall_time();
+}
+
+//------------------------------------------------------------------------------
+//    Returns the number of states of the last cut to solve that weren't
+//    forced to 0
+//------------------------------------------------------------------------------
+std::size_t SparseSolver::getNumFreeMarkers() const
+{
+  return numFreeMarkers;
+}
+
+//------------------------------------------------------------------------------
+//    Returns the number of individuals of the last sparse problem that weren't
+//    forced to 0 or 1
+//------------------------------------------------------------------------------
+std::size_t SparseSolver::getNumFreeIndividuals() const
+{
+  return numFreeIndividuals;
+}
+
 //------------------------------------------------------------------------------
 //    Returns the marker locations in pattern from CPLEX
 //------------------------------------------------------------------------------
 std::vector<std::size_t> SparseSolver::getSolution() const {
   std::vector<std::size_t> solution;
 
-  for(std::size_t i = 0; i < data->numStates; ++i) {
-    if(pattern[i] == 1) {
-      solution.push_back(i);      
+  for(std::size_t c = 0; c < pattern.size(); ++c) {
+    if(pattern[c] == 1) {
+      solution.push_back(stateOfColumn[c]);
     }
   }
+  std::sort(std::begin(solution), std::end(solution));
 
   return solution;
 }
@@ -3,8 +3,11 @@
 
 #include <ilcplex/ilocplex.h>
 #include <ilconcert/ilomodel.h>
+#include <atomic>
+#include <map>
 #include "CutSet.h"
 #include "CSFS.h"
+#include "SparseBranchAndBound.h"
 #include "Timer.h"
 
 class SparseSolver
@@ -28,9 +31,45 @@ class SparseSolver
     std::vector<double> pattern;
 
     double threshold;
+    const std::atomic<double> *sharedLb; // raised by the worker while a problem is solved, or NULL
 
-    Timer timer;
+    std::size_t numFreeMarkers;     // states of the last cut to solve left to the solver
+    std::size_t numFreeIndividuals; // individuals of the last problem left to the solver
 
+    // Cplex items. These are kept from one sparse problem to the next, and
+    // only the differences between consecutive problems are applied. They are
+    // left empty if USE_NATIVE_SPARSE_SOLVER.
+    IloEnv env;
+    IloCplex cplex;
+    IloModel model;
+    IloNumVarArray mark; // one column for every state that has been in a cut to solve
+    IloNumVarArray indiv;
+    IloNumArray markCopy;
+    IloExpr obj;
+    IloRange markSummation;
+    std::vector<IloRange> indivConstraints;         // links each individual to the markers
+    std::vector<IloRange> indivEqualityConstraints; // only valid where modelIndivEquals[j] < numIndiv
+    std::map<Cut, IloRange> cutConstraints;
+
+    std::vector<std::size_t> columnOf;      // column of mark for each state, or numStates if none
+    std::vector<std::size_t> stateOfColumn;
+
+    // What the model currently reflects, for each column of mark
+    std::vector<char> modelMarkLb;
+    std::vector<char> modelMarkUb;
+    std::vector<std::size_t> modelIndVals;
+    std::vector<std::size_t> modelIndivEquals;
+
+    std::vector<std::size_t> incumbent; // best pattern of the previous sparse problem
+
+    SparseBranchAndBound branchAndBound; // used instead of CPLEX if USE_NATIVE_SPARSE_SOLVER
+
+    Timer timer; // counts the solver thread's CPU time (CPLEX runs on one thread)
+
+    void addColumn(const std::size_t);
+    void addMIPStart();
+    void buildModel();
+    std::vector<std::uint64_t> getRemainingCutStates() const;
     std::vector<std::size_t> getSolution() const;
     
     void countNumberOfMarkersInCutToSOlve();
@@ -38,6 +77,10 @@ class SparseSolver
     bool setMarkersToZero();
     bool setIndividualEqualityConstraints();
     void solveMIP(const Cut&);
+    void solveNative();
+    void updateCutConstraints();
+    void updateIndividuals();
+    void updateMarkers();
     
   public:
     SparseSolver(const CSFS_Data &);
@@ -46,10 +89,14 @@ class SparseSolver
     void setMark(const std::size_t, const std::size_t);
     void setIndiv(const std::size_t, const std::size_t);
     void setThreshold(const double);
+    void setSharedLowerBound(const std::atomic<double> *);
     void solve();
     std::vector<Solution> getSolutionPool() const;
     double getObjValue() const;
     double getCpuTimeToSolve() const;
+    double getWallTimeToSolve() const;
+    std::size_t getNumFreeMarkers() const;
+    std::size_t getNumFreeIndividuals() const;
     void roundExtremeValues(std::vector<double> *vec);
 };
 
@@ -0,0 +1,363 @@
+#include "StateMatrix.h"
+#include <algorithm>
+#include <cassert>
+
+//------------------------------------------------------------------------------
+//    Constructors
+//------------------------------------------------------------------------------
+StateMatrix::StateMatrix() : numStates_(0),
+                             numIndiv_(0),
+                             stateWords(0),
+                             indivWords(0)
+{}
+
+
+//------------------------------------------------------------------------------
+// Creates a matrix of the given number of states and individuals in which no
+// individual carries any state
+//------------------------------------------------------------------------------
+StateMatrix::StateMatrix(const std::size_t _numStates,
+                         const std::size_t _numIndiv) : numStates_(_numStates),
+                                                        numIndiv_(_numIndiv),
+                                                        stateWords(numWords(_numIndiv)),
+                                                        indivWords(numWords(_numStates)),
+                                                        stateMajor(_numStates * stateWords, 0),
+                                                        indivMajor(_numIndiv * indivWords, 0)
+{}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of individuals in the inclusive range [first, last] that
+// carry state i
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::countCarrying(const std::size_t i,
+                                       const std::size_t first,
+                                       const std::size_t last) const
+{
+  assert(i < numStates_ && last < numIndiv_);
+
+  return countInRange(stateRow(i), first, last);
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of individuals in the given mask of individuals that
+// carry state i
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::countCarrying(const std::size_t i,
+                                       const std::vector<std::uint64_t> &indivMask) const
+{
+  assert(i < numStates_ && indivMask.size() == stateWords);
+
+  const std::uint64_t *row = stateRow(i);
+  std::size_t count = 0;
+  for (std::size_t w = 0; w < stateWords; ++w)
+    count += popcount(row[w] & indivMask[w]);
+  return count;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of individuals in the inclusive range [first, last] that
+// carry every one of the given states
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::countCarryingAll(const std::vector<std::size_t> &states,
+                                          const std::size_t first,
+                                          const std::size_t last) const
+{
+  assert(last < numIndiv_);
+
+  if (states.empty())
+    return last - first + 1;
+
+  const std::size_t firstWord = first >> 6;
+  const std::size_t lastWord = last >> 6;
+  std::vector<std::uint64_t> carriers(stateRow(states[0]) + firstWord,
+                                      stateRow(states[0]) + lastWord + 1);
+
+  for (std::size_t s = 1; s < states.size(); ++s)
+  {
+    const std::uint64_t *row = stateRow(states[s]) + firstWord;
+    for (std::size_t w = 0; w < carriers.size(); ++w)
+      carriers[w] &= row[w];
+  }
+
+  return countInRange(&carriers[0], first - (firstWord << 6), last - (firstWord << 6));
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of bits set in the inclusive range [first, last] of the
+// given words
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::countInRange(const std::uint64_t *words,
+                                      const std::size_t first,
+                                      const std::size_t last)
+{
+  if (first > last)
+    return 0;
+
+  const std::size_t firstWord = first >> 6;
+  const std::size_t lastWord = last >> 6;
+  const std::uint64_t firstMask = ~std::uint64_t(0) << (first & 63);
+  const std::uint64_t lastMask = ~std::uint64_t(0) >> (63 - (last & 63));
+
+  if (firstWord == lastWord)
+    return popcount(words[firstWord] & firstMask & lastMask);
+
+  std::size_t count = popcount(words[firstWord] & firstMask);
+  for (std::size_t w = firstWord + 1; w < lastWord; ++w)
+    count += popcount(words[w]);
+  count += popcount(words[lastWord] & lastMask);
+
+  return count;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of states individual j carries
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::countStates(const std::size_t j) const
+{
+  assert(j < numIndiv_);
+
+  const std::uint64_t *row = indivRow(j);
+  std::size_t count = 0;
+  for (std::size_t w = 0; w < indivWords; ++w)
+    count += popcount(row[w]);
+  return count;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of states in the given mask of states that individual j
+// carries
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::countStates(const std::size_t j,
+                                     const std::vector<std::uint64_t> &stateMask) const
+{
+  assert(j < numIndiv_ && stateMask.size() == indivWords);
+
+  const std::uint64_t *row = indivRow(j);
+  std::size_t count = 0;
+  for (std::size_t w = 0; w < indivWords; ++w)
+    count += popcount(row[w] & stateMask[w]);
+  return count;
+}
+
+
+//------------------------------------------------------------------------------
+// Groups the given individuals by the states they carry out of the states in
+// the given mask, and returns the groups of two or more. Each masked row is
+// hashed, and rows are only compared word by word when their hashes match.
+// Groups are ordered by, and hold their members in, the order of indivs.
+//------------------------------------------------------------------------------
+std::vector<std::vector<std::size_t> > StateMatrix::groupSameStates(const std::vector<std::size_t> &indivs,
+                                                                    const std::vector<std::uint64_t> &stateMask) const
+{
+  assert(stateMask.size() == indivWords);
+
+  // *
+  // * Hash each individual's masked row, and sort by hash (then position)
+  // *
+  std::vector<std::pair<std::uint64_t, std::size_t> > hashes(indivs.size());
+  for (std::size_t k = 0; k < indivs.size(); ++k)
+  {
+    const std::uint64_t *row = indivRow(indivs[k]);
+    std::uint64_t hash = 0;
+    for (std::size_t w = 0; w < indivWords; ++w)
+    {
+      hash = (hash ^ (row[w] & stateMask[w])) * 0x9E3779B97F4A7C15ULL;
+      hash ^= hash >> 29;
+    }
+    hashes[k] = std::make_pair(hash, k);
+  }
+  std::sort(std::begin(hashes), std::end(hashes));
+
+  // *
+  // * Within a run of equal hashes, put each individual in the first group
+  // * whose first member has the same states
+  // *
+  std::vector<std::vector<std::size_t> > groups; // of positions in indivs
+  for (std::size_t first = 0; first < hashes.size();)
+  {
+    std::size_t last = first + 1;
+    while (last < hashes.size() && hashes[last].first == hashes[first].first)
+      ++last;
+
+    const std::size_t runStart = groups.size();
+    for (std::size_t k = first; k < last; ++k)
+    {
+      const std::size_t pos = hashes[k].second;
+      std::size_t g = runStart;
+      while (g < groups.size() && !sameStates(indivs[groups[g][0]], indivs[pos], stateMask))
+        ++g;
+
+      if (g == groups.size())
+        groups.emplace_back();
+      groups[g].push_back(pos);
+    }
+    first = last;
+  }
+
+  // *
+  // * Keep the groups of two or more, in the order of indivs
+  // *
+  std::vector<std::vector<std::size_t> > sameGroups;
+  for (auto it = std::begin(groups); it != std::end(groups); ++it)
+  {
+    if (it->size() >= 2)
+      sameGroups.push_back(*it);
+  }
+  std::sort(std::begin(sameGroups), std::end(sameGroups));
+
+  for (auto it = std::begin(sameGroups); it != std::end(sameGroups); ++it)
+  {
+    for (auto pos = std::begin(*it); pos != std::end(*it); ++pos)
+      *pos = indivs[*pos];
+  }
+  return sameGroups;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of words in an individual's row of states
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::indivRowWords() const
+{
+  return indivWords;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of individuals
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::numIndiv() const
+{
+  return numIndiv_;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of states
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::numStates() const
+{
+  return numStates_;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of 64-bit words needed to hold the given number of bits
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::numWords(const std::size_t numBits)
+{
+  return (numBits + 63) >> 6;
+}
+
+
+//------------------------------------------------------------------------------
+// Returns true if individuals x and y carry exactly the same states out of
+// the states in the given mask
+//------------------------------------------------------------------------------
+bool StateMatrix::sameStates(const std::size_t x,
+                             const std::size_t y,
+                             const std::vector<std::uint64_t> &stateMask) const
+{
+  assert(x < numIndiv_ && y < numIndiv_ && stateMask.size() == indivWords);
+
+  const std::uint64_t *rowX = indivRow(x);
+  const std::uint64_t *rowY = indivRow(y);
+  for (std::size_t w = 0; w < indivWords; ++w)
+  {
+    if ((rowX[w] ^ rowY[w]) & stateMask[w])
+      return false;
+  }
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Sets whether or not individual j carries state i
+//------------------------------------------------------------------------------
+void StateMatrix::set(const std::size_t i, const std::size_t j, const bool val)
+{
+  assert(i < numStates_ && j < numIndiv_);
+
+  const std::uint64_t stateBit = std::uint64_t(1) << (j & 63);
+  const std::uint64_t indivBit = std::uint64_t(1) << (i & 63);
+
+  if (val)
+  {
+    stateMajor[i * stateWords + (j >> 6)] |= stateBit;
+    indivMajor[j * indivWords + (i >> 6)] |= indivBit;
+  }
+  else
+  {
+    stateMajor[i * stateWords + (j >> 6)] &= ~stateBit;
+    indivMajor[j * indivWords + (i >> 6)] &= ~indivBit;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Replaces the matrix with the given state-major rows (numStates() rows of
+// stateRowWords() words each) and rebuilds the individual-major copy
+//------------------------------------------------------------------------------
+void StateMatrix::setStateRows(const std::uint64_t *rows)
+{
+  std::copy(rows, rows + stateMajor.size(), std::begin(stateMajor));
+  if (numIndiv_ > 0)
+    updateIndivRows(0, numIndiv_ - 1);
+}
+
+
+//------------------------------------------------------------------------------
+// Rebuilds the individual-major rows of the individuals in the inclusive range
+// [first, last] from the state-major rows. Needed after state rows have been
+// written through mutableStateRow(). Calls for disjoint ranges write disjoint
+// memory, so they may run on separate threads.
+//------------------------------------------------------------------------------
+void StateMatrix::updateIndivRows(const std::size_t first, const std::size_t last)
+{
+  assert(first <= last && last < numIndiv_);
+
+  std::fill(indivMajor.begin() + first * indivWords, indivMajor.begin() + (last + 1) * indivWords, 0);
+
+  const std::size_t firstWord = first >> 6;
+  const std::size_t lastWord = last >> 6;
+  const std::uint64_t firstMask = ~std::uint64_t(0) << (first & 63);
+  const std::uint64_t lastMask = ~std::uint64_t(0) >> (63 - (last & 63));
+
+  for (std::size_t i = 0; i < numStates_; ++i)
+  {
+    const std::uint64_t *row = stateRow(i);
+    const std::size_t stateWord = i >> 6;
+    const std::uint64_t indivBit = std::uint64_t(1) << (i & 63);
+
+    for (std::size_t w = firstWord; w <= lastWord; ++w)
+    {
+      std::uint64_t word = row[w];
+      if (w == firstWord)
+        word &= firstMask;
+      if (w == lastWord)
+        word &= lastMask;
+
+      while (word)
+      {
+        const std::size_t j = (w << 6) + __builtin_ctzll(word);
+        indivMajor[j * indivWords + stateWord] |= indivBit;
+        word &= word - 1;
+      }
+    }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the number of words in a state's row of individuals
+//------------------------------------------------------------------------------
+std::size_t StateMatrix::stateRowWords() const
+{
+  return stateWords;
+}
@@ -0,0 +1,139 @@
+// *
+// * Bit-packed matrix of which individuals carry which marker states. The
+// * matrix is stored twice: once state-major (each state's row is a bitset
+// * over individuals) and once individual-major (each individual's row is a
+// * bitset over states), so that both "who carries state i" and "which states
+// * does individual j carry" can be answered with word-parallel operations.
+// *
+
+#ifndef STATE_MATRIX_H
+#define STATE_MATRIX_H
+
+#include <cstdint>
+#include <vector>
+
+class StateMatrix
+{
+  private:
+    std::size_t numStates_;
+    std::size_t numIndiv_;
+    std::size_t stateWords; // number of words in a state's row of individuals
+    std::size_t indivWords; // number of words in an individual's row of states
+    std::vector<std::uint64_t> stateMajor;
+    std::vector<std::uint64_t> indivMajor;
+
+  public:
+    StateMatrix();
+    StateMatrix(const std::size_t, const std::size_t);
+
+    std::size_t countCarrying(const std::size_t, const std::size_t, const std::size_t) const;
+    std::size_t countCarrying(const std::size_t, const std::vector<std::uint64_t> &) const;
+    std::size_t countCarryingAll(const std::vector<std::size_t> &,
+                                 const std::size_t,
+                                 const std::size_t) const;
+    std::size_t countStates(const std::size_t) const;
+    std::size_t countStates(const std::size_t, const std::vector<std::uint64_t> &) const;
+    std::vector<std::vector<std::size_t> > groupSameStates(const std::vector<std::size_t> &,
+                                                           const std::vector<std::uint64_t> &) const;
+    std::size_t indivRowWords() const;
+    std::size_t numIndiv() const;
+    std::size_t numStates() const;
+    bool sameStates(const std::size_t,
+                    const std::size_t,
+                    const std::vector<std::uint64_t> &) const;
+    void set(const std::size_t, const std::size_t, const bool = true);
+    void setStateRows(const std::uint64_t *);
+    std::size_t stateRowWords() const;
+    void updateIndivRows(const std::size_t, const std::size_t);
+
+    const std::uint64_t *indivRow(const std::size_t j) const
+    {
+      return &indivMajor[j * indivWords];
+    }
+
+    const std::uint64_t *stateRow(const std::size_t i) const
+    {
+      return &stateMajor[i * stateWords];
+    }
+
+    // Writable state-major row of state i. The individual-major copy is not
+    // kept up to date; call updateIndivRows() once the rows are written.
+    std::uint64_t *mutableStateRow(const std::size_t i)
+    {
+      return &stateMajor[i * stateWords];
+    }
+
+    // Returns whether or not individual j carries state i
+    bool operator()(const std::size_t i, const std::size_t j) const
+    {
+      return (stateMajor[i * stateWords + (j >> 6)] >> (j & 63)) & 1;
+    }
+
+    // Calls f(j) for every individual j carrying state i
+    template <typename F>
+    void forEachCarrier(const std::size_t i, F f) const
+    {
+      forEachBit(stateRow(i), stateWords, numIndiv_, false, f);
+    }
+
+    // Calls f(j) for every individual j not carrying state i
+    template <typename F>
+    void forEachNonCarrier(const std::size_t i, F f) const
+    {
+      forEachBit(stateRow(i), stateWords, numIndiv_, true, f);
+    }
+
+    // Calls f(i) for every state i carried by individual j
+    template <typename F>
+    void forEachState(const std::size_t j, F f) const
+    {
+      forEachBit(indivRow(j), indivWords, numStates_, false, f);
+    }
+
+    // Calls f(i) for every state i not carried by individual j
+    template <typename F>
+    void forEachMissingState(const std::size_t j, F f) const
+    {
+      forEachBit(indivRow(j), indivWords, numStates_, true, f);
+    }
+
+    static std::size_t countInRange(const std::uint64_t *,
+                                    const std::size_t,
+                                    const std::size_t);
+    static std::size_t numWords(const std::size_t);
+
+    static std::size_t popcount(const std::uint64_t word)
+    {
+      return __builtin_popcountll(word);
+    }
+
+    static void setBit(std::vector<std::uint64_t> *words, const std::size_t i)
+    {
+      (*words)[i >> 6] |= std::uint64_t(1) << (i & 63);
+    }
+
+    // Calls f(b) for every bit b < numBits that is set (or clear, if
+    // complement is true) in the given words
+    template <typename F>
+    static void forEachBit(const std::uint64_t *words,
+                           const std::size_t wordCount,
+                           const std::size_t numBits,
+                           const bool complement,
+                           F f)
+    {
+      for (std::size_t w = 0; w < wordCount; ++w)
+      {
+        std::uint64_t word = complement ? ~words[w] : words[w];
+        if (w == wordCount - 1 && (numBits & 63))
+          word &= (std::uint64_t(1) << (numBits & 63)) - 1;
+
+        while (word)
+        {
+          f((w << 6) + __builtin_ctzll(word));
+          word &= word - 1;
+        }
+      }
+    }
+};
+
+#endif
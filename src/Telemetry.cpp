@@ -0,0 +1,102 @@
+#include "Telemetry.h"
+#include <cmath>
+
+//------------------------------------------------------------------------------
+//    Constructor
+//------------------------------------------------------------------------------
+Telemetry::Telemetry(const CSFS_Data &_data) : data(&_data)
+{
+  if (data->telemetryFileName.empty())
+    return;
+
+  file.open(data->telemetryFileName.c_str());
+  if (!file.is_open())
+    throw std::runtime_error("Telemetry file could not be opened");
+
+  record.precision(9);
+}
+
+
+//------------------------------------------------------------------------------
+// Writes the separator and the quoted name of the next field
+//------------------------------------------------------------------------------
+void Telemetry::addName(const std::string &name)
+{
+  record << ",\"" << name << "\":";
+}
+
+
+//------------------------------------------------------------------------------
+// Returns true if records are written. Callers can skip gathering the fields
+// of a record otherwise.
+//------------------------------------------------------------------------------
+bool Telemetry::enabled() const
+{
+  return file.is_open();
+}
+
+
+//------------------------------------------------------------------------------
+// Starts a record of an event
+//------------------------------------------------------------------------------
+void Telemetry::begin(const std::string &event)
+{
+  record.str("");
+  record << "{\"event\":\"" << event << "\"";
+  add("wall", data->elapsed_wall_time());
+  add("cpu", data->elapsed_cpu_time());
+}
+
+
+//------------------------------------------------------------------------------
+// Adds a number to the current record. JSON has no infinity or NaN, so those
+// are written as null.
+//------------------------------------------------------------------------------
+void Telemetry::add(const std::string &name, const double value)
+{
+  addName(name);
+  if (std::isfinite(value))
+    record << value;
+  else
+    record << "null";
+}
+
+
+//------------------------------------------------------------------------------
+// Adds a string to the current record
+//------------------------------------------------------------------------------
+void Telemetry::add(const std::string &name, const std::string &value)
+{
+  addName(name);
+  record << '"';
+  for (auto it = std::begin(value); it != std::end(value); ++it)
+  {
+    if (*it == '"' || *it == '\\')
+      record << '\\';
+    record << *it;
+  }
+  record << '"';
+}
+
+
+//------------------------------------------------------------------------------
+// Adds a string to the current record
+//------------------------------------------------------------------------------
+void Telemetry::add(const std::string &name, const char *value)
+{
+  add(name, std::string(value));
+}
+
+
+//------------------------------------------------------------------------------
+// Writes the current record. The file is flushed, so it can be followed while
+// the run goes on.
+//------------------------------------------------------------------------------
+void Telemetry::end()
+{
+  if (!file.is_open())
+    return;
+
+  file << record.str() << "}\n";
+  file.flush();
+}
@@ -0,0 +1,48 @@
+// *
+// * Writes performance records to TELEMETRY_FILE, one JSON object per line.
+// * Each record holds its event name, the wall clock and CPU seconds since the
+// * data was loaded, and the fields added between begin() and end(). Nothing
+// * is written when TELEMETRY_FILE wasn't given.
+// *
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "CSFS_Data.h"
+
+class Telemetry
+{
+  private:
+    const CSFS_Data *data;
+    std::ofstream file;
+    std::ostringstream record;
+
+    void addName(const std::string &);
+
+  public:
+    Telemetry(const CSFS_Data &);
+    bool enabled() const;
+    void begin(const std::string &);
+    void add(const std::string &, const double);
+    void add(const std::string &, const std::string &);
+    void add(const std::string &, const char *);
+    template <typename T> void add(const std::string &, const T &);
+    void end();
+};
+
+
+//------------------------------------------------------------------------------
+// Adds an integer field to the current record
+//------------------------------------------------------------------------------
+template <typename T>
+void Telemetry::add(const std::string &name, const T &value)
+{
+  addName(name);
+  record << value;
+}
+
+#endif
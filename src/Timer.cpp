@@ -2,12 +2,18 @@
 
 //------------------------------------------------------------------------------
 //    Constructor
-//------------------------------------------------------------------------------
-Timer::Timer(const bool _running) : running(_running),
-                                    accumulatedCpuTime(0),
-                                    accumulatedWallTime(0),
-                                    startCpuTime(running ? get_cpu_time() : 0),
-                                    startWallTime(running ? get_wall_time() : 0)
+//
+// The CPU time is that of the whole process, unless threadCpuTime is set. Then
+// it is only that of the calling thread, so the timer must be started and
+// stopped on the same thread.
+//------------------------------------------------------------------------------
+Timer::Timer(const bool _running,
+             const bool _threadCpuTime) : running(_running),
+                                          threadCpuTime(_threadCpuTime),
+                                          accumulatedCpuTime(0),
+                                          accumulatedWallTime(0),
+                                          startCpuTime(running ? get_cpu_time() : 0),
+                                          startWallTime(running ? get_wall_time() : 0)
 {}
 
 
@@ -28,9 +34,9 @@ tm *Timer::current_time() const
 double Timer::elapsed_cpu_time() const
 {
   if (running)
-    return (get_cpu_time() - startCpuTime + accumulatedCpuTime) / CLOCKS_PER_SEC;
+    return get_cpu_time() - startCpuTime + accumulatedCpuTime;
 
-  return accumulatedCpuTime / CLOCKS_PER_SEC;
+  return accumulatedCpuTime;
 }
 
 
@@ -47,22 +53,25 @@ double Timer::elapsed_wall_time() const
 
 
 //------------------------------------------------------------------------------
-// Returns the current CPU time.
+// Returns the current CPU time in seconds.
 //------------------------------------------------------------------------------
 double Timer::get_cpu_time() const
 {
-  return clock();
+  struct timespec time;
+  clock_gettime(threadCpuTime ? CLOCK_THREAD_CPUTIME_ID : CLOCK_PROCESS_CPUTIME_ID, &time);
+  return time.tv_sec + time.tv_nsec * 0.000000001;
 }
 
 
 //------------------------------------------------------------------------------
-// Returns the current wall time.
+// Returns the current wall time in seconds. The clock is monotonic, so setting
+// the system time doesn't change the elapsed time.
 //------------------------------------------------------------------------------
 double Timer::get_wall_time() const
 {
-  struct timeval time;
-  gettimeofday(&time, NULL);
-  return time.tv_sec + time.tv_usec * 0.000001;
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 0.000000001;
 }
 
 
@@ -9,6 +9,7 @@ class Timer
 {
   private:
     bool running;
+    bool threadCpuTime; // count the CPU time of the calling thread only
     double accumulatedCpuTime;
     double accumulatedWallTime;
     double startCpuTime;
@@ -18,7 +19,7 @@ class Timer
     double get_wall_time() const;
 
   public:
-    Timer(const bool = false);
+    Timer(const bool = false, const bool = false);
     tm *current_time() const;
     double elapsed_cpu_time() const;
     double elapsed_wall_time() const;
@@ -1,4 +1,12 @@
 #include "VariableEqualities.h"
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+//    Constructor
+//------------------------------------------------------------------------------
+VariableEqualities::VariableEqualities() : numEqualities(0)
+{}
+
 
 //------------------------------------------------------------------------------
 // Adds an equality between x and y. Returns true if an equality was added,
@@ -6,63 +14,28 @@
 //------------------------------------------------------------------------------
 bool VariableEqualities::add(const std::size_t x, const std::size_t y)
 {
+  grow(std::max(x, y) + 1);
+
+  std::size_t root_x = find(x);
+  std::size_t root_y = find(y);
+
   // *
   // * Return false if an equality between x and y already exists
   // *
-  if (exists(x, y))
+  if (root_x == root_y)
     return false;
 
-  std::size_t set_x;
-  std::size_t set_y;
-  bool found_x = false;
-  bool found_y = false;
-
   // *
-  // * Find the sets that x and y are in
+  // * Hang the smaller class under the larger, and splice the cycles of
+  // * members together
   // *
-  for (std::size_t j = 0; j < sets.size(); ++j)
-  {
-    if (sets[j].find(x) != std::end(sets[j]))
-    {
-      set_x = j;
-      found_x = true;
-      break;
-    }
-  }
-  for (std::size_t j = 0; j < sets.size(); ++j)
-  {
-    if (sets[j].find(y) != std::end(sets[j]))
-    {
-      set_y = j;
-      found_y = false;
-      break;
-    }
-  }
+  if (classSize[root_x] < classSize[root_y])
+    std::swap(root_x, root_y);
 
-  // *
-  // * Add the equality
-  // *
-  if (!found_x && !found_y) // neither is in a set
-  {
-    std::set<std::size_t> temp;
-    temp.insert(x);
-    temp.insert(y);
-    sets.push_back(temp);
-  }
-  else if (found_x && !found_y) // x is in a set, but not y
-  {
-    sets[set_x].insert(y);
-  }
-  else if (!found_x && found_y) // y is in a set, but not x
-  {
-    sets[set_y].insert(x);
-  }
-  else // they're both in a different set
-  {
-    for (auto j = std::begin(sets[set_y]); j != std::end(sets[set_y]); ++j)
-      sets[set_x].insert(*j);
-    sets.erase(std::begin(sets) + set_y);
-  }
+  parent[root_y] = root_x;
+  classSize[root_x] += classSize[root_y];
+  std::swap(next[x], next[y]);
+  ++numEqualities;
 
   return true;
 }
@@ -73,7 +46,10 @@ bool VariableEqualities::add(const std::size_t x, const std::size_t y)
 //------------------------------------------------------------------------------
 void VariableEqualities::clear()
 {
-  sets.clear();
+  parent.clear();
+  classSize.clear();
+  next.clear();
+  numEqualities = 0;
 }
 
 
@@ -82,7 +58,7 @@ void VariableEqualities::clear()
 //------------------------------------------------------------------------------
 bool VariableEqualities::empty() const
 {
-  return sets.empty();
+  return numEqualities == 0;
 }
 
 
@@ -91,13 +67,7 @@ bool VariableEqualities::empty() const
 //------------------------------------------------------------------------------
 bool VariableEqualities::exists(const std::size_t x) const
 {
-  for (std::size_t i = 0; i < sets.size(); ++i)
-  {
-    const auto search_x = sets[i].find(x); // find x
-    if (search_x != std::end(sets[i])) // if x was found
-      return true;
-  }
-  return false;
+  return x < parent.size() && classSize[find(x)] > 1;
 }
 
 
@@ -106,19 +76,24 @@ bool VariableEqualities::exists(const std::size_t x) const
 //------------------------------------------------------------------------------
 bool VariableEqualities::exists(const std::size_t x, const std::size_t y) const
 {
-  for (std::size_t i = 0; i < sets.size(); ++i)
+  if (x == y)
+    return exists(x);
+
+  return x < parent.size() && y < parent.size() && find(x) == find(y);
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the root of the class x is in, halving the path to it on the way
+//------------------------------------------------------------------------------
+std::size_t VariableEqualities::find(std::size_t x) const
+{
+  while (parent[x] != x)
   {
-    const auto search_x = sets[i].find(x); // find x
-    if (search_x != std::end(sets[i])) // if x was found, find y
-    {
-      const auto search_y = sets[i].find(y);
-      if (search_y != std::end(sets[i])) // if y was also found, equality exists
-        return true;
-      else
-        return false;
-    }
+    parent[x] = parent[parent[x]];
+    x = parent[x];
   }
-  return false;
+  return x;
 }
 
 
@@ -129,11 +104,20 @@ bool VariableEqualities::exists(const std::size_t x, const std::size_t y) const
 std::vector<std::vector<std::size_t> > VariableEqualities::get2dVector() const
 {
   std::vector<std::vector<std::size_t> > vec;
-  for (std::size_t i = 0; i < sets.size(); ++i)
+  std::vector<char> visited(parent.size(), 0);
+
+  for (std::size_t i = 0; i < parent.size(); ++i)
   {
+    if (visited[i] || classSize[find(i)] < 2)
+      continue;
+
     std::vector<std::size_t> row;
-    for (auto it = std::begin(sets[i]); it != std::end(sets[i]); ++it)
-      row.push_back(*it);
+    forEachEqual(i, [&](const std::size_t j)
+    {
+      visited[j] = 1;
+      row.push_back(j);
+    });
+    std::sort(std::begin(row), std::end(row));
     vec.push_back(row);
   }
   return vec;
@@ -146,6 +130,7 @@ std::vector<std::vector<std::size_t> > VariableEqualities::get2dVector() const
 //------------------------------------------------------------------------------
 std::string VariableEqualities::getEqualitiesString() const
 {
+  const std::vector<std::vector<std::size_t> > sets = get2dVector();
   std::ostringstream oss;
   for (std::size_t i = 0; i < sets.size(); ++i)
   {
@@ -158,17 +143,29 @@ std::string VariableEqualities::getEqualitiesString() const
 }
 
 
+//------------------------------------------------------------------------------
+// Makes room for variables 0 to n-1, each new one in a class of its own
+//------------------------------------------------------------------------------
+void VariableEqualities::grow(const std::size_t n)
+{
+  for (std::size_t x = parent.size(); x < n; ++x)
+  {
+    parent.push_back(x);
+    classSize.push_back(1);
+    next.push_back(x);
+  }
+}
+
+
 //------------------------------------------------------------------------------
 // Takes another VariableEqualities object and merges those equalities into this
 // object.
 //------------------------------------------------------------------------------
 void VariableEqualities::merge(const VariableEqualities &other)
 {
-  const std::vector<std::vector<std::size_t> > otherVec = other.get2dVector();
-  for (std::size_t i = 0; i < otherVec.size(); ++i)
+  for (std::size_t x = 0; x < other.next.size(); ++x)
   {
-    for (std::size_t j = 1; j < otherVec[i].size(); ++j)
-      add(otherVec[i][0], otherVec[i][j]);
+    if (other.next[x] != x)
+      add(x, other.next[x]);
   }
 }
-
@@ -5,12 +5,26 @@
 #include <sstream>
 #include <vector>
 
+// *
+// * Equivalence classes of variables kept in a union-find forest, with union
+// * by size and path halving. The members of each class are also linked in a
+// * cycle through next, so a class can be walked without scanning every
+// * variable. Variables are added on first use.
+// *
 class VariableEqualities
 {
   private:
-    std::vector<std::set<std::size_t> > sets;
+    mutable std::vector<std::size_t> parent;
+    std::vector<std::size_t> classSize; // valid at the root of a class
+    std::vector<std::size_t> next;
+    std::size_t numEqualities;
+
+    std::size_t find(const std::size_t) const;
+    void grow(const std::size_t);
 
   public:
+    VariableEqualities();
+
     bool add(const std::size_t, const std::size_t);
     void clear();
     bool empty() const;
@@ -19,7 +33,24 @@ class VariableEqualities
     std::vector<std::vector<std::size_t> > get2dVector() const;
     std::string getEqualitiesString() const;
     void merge(const VariableEqualities &);
+
+    // Calls f(j) for every variable j equal to x, including x itself
+    template <typename F>
+    void forEachEqual(const std::size_t x, F f) const
+    {
+      if (x >= next.size())
+      {
+        f(x);
+        return;
+      }
+
+      std::size_t j = x;
+      do
+      {
+        f(j);
+        j = next[j];
+      } while (j != x);
+    }
 };
 
 #endif
-
@@ -0,0 +1,447 @@
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <random>
+
+#include "CutAndSolveController.h"
+#include "CutAndSolveWorker.h"
+#include "Heuristic.h"
+#include "Presolve.h"
+
+// *
+// * csfs-bench times the parts of cut and solve on the data set of a config
+// * file (such as one written by csfs-generate) and compares them with a
+// * baseline file: loading the data, adding cuts to a CutSet, solving the
+// * relaxation, solving sparse problems, an MPI round trip of a packed
+// * problem, and the whole cut and solve. Run it with at least 2 processes;
+// * the round trip and the whole run need a worker.
+// *
+// * Every result is the wall clock seconds of one operation, so lower is
+// * better. With --update the results are written as the new baseline;
+// * without it, a baseline with no results is an error.
+// *
+namespace
+{
+  struct Measurement
+  {
+    std::string name;
+    double seconds;   // wall seconds per operation
+    double items;     // items handled per operation
+    std::string unit; // what the items are
+  };
+
+
+  //----------------------------------------------------------------------------
+  // Returns the peak resident memory of this process in megabytes
+  //----------------------------------------------------------------------------
+  double peakMemory()
+  {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; // kilobytes on Linux
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Returns the given number of random cuts, each of cutSize distinct states
+  //----------------------------------------------------------------------------
+  std::vector<Cut> randomCuts(const CSFS_Data &data, const std::size_t numCuts, const std::size_t cutSize)
+  {
+    std::mt19937_64 rng(data.CPLEX_SEED);
+    std::vector<std::size_t> states(data.numStates);
+    for (std::size_t i = 0; i < data.numStates; ++i)
+      states[i] = i;
+
+    std::vector<Cut> cuts;
+    for (std::size_t c = 0; c < numCuts; ++c)
+    {
+      std::shuffle(std::begin(states), std::end(states), rng);
+      Cut cut(data.numStates);
+      for (std::size_t k = 0; k < cutSize; ++k)
+        cut.add(states[k]);
+      cuts.push_back(cut);
+    }
+    return cuts;
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Times adding every cut to an empty CutSet
+  //----------------------------------------------------------------------------
+  Measurement benchCutSet(const CSFS_Data &data, const std::vector<Cut> &cuts)
+  {
+    CutSet cutSet(data.numStates);
+    Timer timer(true);
+    for (auto it = std::begin(cuts); it != std::end(cuts); ++it)
+      cutSet.add(*it);
+    timer.stop();
+
+    Measurement m = {"cutset_add", timer.elapsed_wall_time() / cuts.size(), 1, "cuts"};
+    return m;
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Times solving the relaxation, adding one cut before each solve as the
+  // controller does
+  //----------------------------------------------------------------------------
+  Measurement benchRelaxation(const CSFS_Data &data, const std::vector<Cut> &cuts, const std::size_t numSolves)
+  {
+    RelaxationSolver rs(data);
+    double seconds = 0;
+    for (std::size_t s = 0; s < numSolves; ++s)
+    {
+      rs.add(cuts[s % cuts.size()]);
+      rs.solve();
+      seconds += rs.getWallTimeToSolve();
+    }
+
+    Measurement m = {"relaxation_solve", seconds / numSolves, 1, "solves"};
+    return m;
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Times solving the sparse problem of each cut, with the cuts before it in
+  // the cut set and the best objective value so far as the threshold, as a
+  // worker would get them
+  //----------------------------------------------------------------------------
+  Measurement benchSparse(const CSFS_Data &data, const std::vector<Cut> &cuts, const std::size_t numProblems)
+  {
+    SparseSolver ss(data);
+    double seconds = 0;
+    double best = 0;
+    for (std::size_t p = 0; p < numProblems; ++p)
+    {
+      for (std::size_t i = 0; i < data.numStates; ++i)
+        ss.setMark(i, 2);
+      for (std::size_t j = 0; j < data.numIndiv; ++j)
+        ss.setIndiv(j, 2);
+      ss.setThreshold(best);
+      ss.setCutToSolve(cuts[p % cuts.size()]);
+      for (std::size_t c = 0; c < p && c < cuts.size(); ++c)
+        ss.addToCutSet(cuts[c]);
+
+      ss.solve();
+      seconds += ss.getWallTimeToSolve();
+      best = std::max(best, ss.getObjValue());
+    }
+
+    Measurement m = {"sparse_solve", seconds / numProblems, 1, "problems"};
+    return m;
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Times sending a packed problem from rank 0 to rank 1 and a solution back.
+  // Called on every rank; ranks other than 0 and 1 return at once.
+  //----------------------------------------------------------------------------
+  Measurement benchRoundTrip(const CSFS_Data &data, const std::vector<Cut> &cuts, const std::size_t numTrips)
+  {
+    const int world_rank = Parallel::getWorldRank();
+    Measurement m = {"mpi_round_trip", 0, 0, "bytes"};
+    if (world_rank > 1)
+      return m;
+
+    MessageBuffer problem;
+    problem.putVersion();
+    problem.put(0.0);
+    problem.put(static_cast<std::uint32_t>(0));
+    problem.putIndexSet(cuts[0].getTrueElements(), data.numStates);
+    problem.put(static_cast<std::uint64_t>(cuts.size()));
+    for (auto it = std::begin(cuts); it != std::end(cuts); ++it)
+      problem.putIndexSet(it->getTrueElements(), data.numStates);
+
+    MessageBuffer solution;
+    solution.putVersion();
+    solution.put(static_cast<std::uint32_t>(0));
+    solution.put(static_cast<std::uint64_t>(1));
+    solution.put(0.0);
+    for (std::size_t k = 0; k < data.setSize; ++k)
+      solution.put(static_cast<std::uint32_t>(k));
+
+    MessageBuffer received;
+    MPI_Status status;
+    MPI_Request request;
+    Timer timer(true);
+    for (std::size_t t = 0; t < numTrips; ++t)
+    {
+      if (world_rank == 0)
+      {
+        problem.isend(1, Parallel::SPARSE_TAG, &request);
+        received.receive(1, Parallel::SPARSE_TAG, &status);
+      }
+      else
+      {
+        received.receive(0, Parallel::SPARSE_TAG, &status);
+        solution.isend(0, Parallel::SPARSE_TAG, &request);
+      }
+      MPI_Wait(&request, MPI_STATUS_IGNORE);
+    }
+    timer.stop();
+
+    m.seconds = timer.elapsed_wall_time() / numTrips;
+    m.items = problem.size() + solution.size();
+    return m;
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Times the whole of cut and solve, heuristic and presolve included, as csfs runs it.
+  // Called on every rank.
+  //----------------------------------------------------------------------------
+  Measurement benchCutAndSolve(const CSFS_Data &fullData)
+  {
+    Timer timer(true);
+
+    std::vector<std::size_t> knownPattern;
+    double knownObjValue = fullData.STARTING_LOWER_BOUND;
+    if (fullData.HEURISTIC_STARTS > 0 && !fullData.USE_SOLUTION_POOL_THRESHOLD)
+    {
+      double objValue;
+      knownPattern = Heuristic::bestPattern(fullData, &objValue);
+      if (!knownPattern.empty())
+        knownObjValue = objValue;
+    }
+
+    std::unique_ptr<const CSFS_Data> presolved;
+    if (fullData.PRESOLVE)
+    {
+      const std::vector<std::size_t> kept = Presolve::keptStates(fullData, knownPattern, knownObjValue);
+      if (kept.size() < fullData.numStates)
+        presolved.reset(new CSFS_Data(fullData, kept));
+    }
+    const CSFS_Data &data = presolved ? *presolved : fullData;
+
+    if (Parallel::getWorldRank() == 0)
+    {
+      CutAndSolveController controller(data);
+      if (!knownPattern.empty())
+        controller.warmStart(knownPattern);
+      while ( !controller.converged() )
+        controller.work();
+
+      controller.signalWorkersToEnd();
+
+      while ( controller.workersStillWorking() )
+        controller.waitForWorkers();
+    }
+    else
+    {
+      CutAndSolveWorker worker(data);
+      while ( !worker.end() )
+        worker.work();
+    }
+
+    timer.stop();
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    Measurement m = {"cut_and_solve", timer.elapsed_wall_time(), 1, "runs"};
+    return m;
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Reads a baseline file: one result per line, its name and its seconds.
+  // Returns no results if the file doesn't exist.
+  //----------------------------------------------------------------------------
+  std::map<std::string, double> readBaseline(const std::string &filename)
+  {
+    std::map<std::string, double> baseline;
+    std::ifstream input(filename.c_str());
+    std::string line;
+    while (std::getline(input, line))
+    {
+      std::istringstream fields(line);
+      std::string name;
+      double seconds;
+      if (!(fields >> name) || name[0] == '#')
+        continue;
+      if (!(fields >> seconds))
+        throw std::runtime_error("Baseline file " + filename + " has no time for " + name + ".");
+      baseline[name] = seconds;
+    }
+    return baseline;
+  }
+
+
+  //----------------------------------------------------------------------------
+  // Writes the results as a baseline file
+  //----------------------------------------------------------------------------
+  void writeBaseline(const std::string &filename,
+                     const std::vector<Measurement> &results,
+                     const CSFS_Data &data)
+  {
+    std::ofstream output(filename.c_str());
+    if (!output.is_open())
+      throw std::runtime_error("Could not open " + filename + " for writing.");
+
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+
+    output << "# csfs-bench baseline: wall seconds per operation\n"
+           << "# " << data.numActualExprs << " expressions, " << data.numCase << " cases, "
+           << data.numCtrl << " controls, " << data.numBins << " bins, pattern size " << data.setSize
+           << ", " << Parallel::getWorldSize() << " processes on " << host << "\n";
+    output.precision(9);
+    for (auto it = std::begin(results); it != std::end(results); ++it)
+      output << it->name << "  " << it->seconds << "\n";
+
+    if (!output)
+      throw std::runtime_error("Could not write " + filename + ".");
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  int provided;
+  MPI_Init_thread(NULL, NULL, MPI_THREAD_FUNNELED, &provided);
+
+  const int world_rank = Parallel::getWorldRank();
+  const int world_size = Parallel::getWorldSize();
+  int exitCode = 0;
+
+  try
+  {
+    if (world_rank == 0)
+    {
+      std::ostringstream oss;
+      if (argc != 3 && !(argc == 4 && std::string(argv[3]) == "--update"))
+        oss << "Usage:\n   " << argv[0] << " <config file> <baseline file> [--update]";
+      else if (world_size < 2)
+        oss << "world_size must be greater than 1.";
+      else if (argc == 3 && readBaseline(argv[2]).empty())
+        oss << "The baseline " << argv[2] << " has no results to compare with. Record it on this "
+            << "machine with --update (make bench BENCH_FLAGS=--update).";
+
+      if ( !oss.str().empty() )
+      {
+        std::cerr << oss.str() << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+    }
+
+    // *
+    // * Load the data, as every rank does in csfs
+    // *
+    Timer loadTimer(true);
+    const CSFS_Data data(argv[1]);
+    loadTimer.stop();
+
+    const ConfigParser &parser = data.parser;
+    const std::size_t numCuts = parser.contains("BENCH_CUTS") ? parser.getSizeT("BENCH_CUTS") : 200;
+    const std::size_t cutSize = parser.contains("BENCH_CUT_SIZE") ? parser.getSizeT("BENCH_CUT_SIZE")
+                                                                  : std::min(data.numStates, std::max(4 * data.setSize, data.numStates / 10));
+    const std::size_t numRelaxations = parser.contains("BENCH_RELAXATIONS") ? parser.getSizeT("BENCH_RELAXATIONS") : 50;
+    const std::size_t numProblems = parser.contains("BENCH_SPARSE_PROBLEMS") ? parser.getSizeT("BENCH_SPARSE_PROBLEMS") : 20;
+    const std::size_t numTrips = parser.contains("BENCH_ROUND_TRIPS") ? parser.getSizeT("BENCH_ROUND_TRIPS") : 100;
+    const double tolerance = parser.contains("BENCH_TOLERANCE") ? parser.getDouble("BENCH_TOLERANCE") : 0.2;
+
+    if (numCuts == 0 || numRelaxations == 0 || numProblems == 0 || numTrips == 0
+    ||  cutSize < data.setSize || cutSize > data.numStates)
+      throw std::runtime_error("The BENCH_ counts must be positive, and BENCH_CUT_SIZE between PATTERN_SIZE and the number of states.");
+
+    const double loadMemory = peakMemory();
+    std::vector<Measurement> results;
+    {
+      Measurement m = {"load", loadTimer.elapsed_wall_time(), static_cast<double>(data.numActualExprs * data.numIndiv), "values"};
+      results.push_back(m);
+    }
+
+    // *
+    // * The components on their own
+    // *
+    const std::vector<Cut> cuts = randomCuts(data, numCuts, cutSize);
+    if (world_rank == 0)
+    {
+      results.push_back(benchCutSet(data, cuts));
+      results.push_back(benchRelaxation(data, cuts, numRelaxations));
+      results.push_back(benchSparse(data, cuts, numProblems));
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    results.push_back(benchRoundTrip(data, std::vector<Cut>(cuts.begin(), cuts.begin() + std::min(numCuts, numProblems)), numTrips));
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // *
+    // * The whole run
+    // *
+    results.push_back(benchCutAndSolve(data));
+
+    double maxLoadMemory;
+    double maxMemory;
+    const double memory = peakMemory();
+    MPI_Reduce(&loadMemory, &maxLoadMemory, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&memory, &maxMemory, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    // *
+    // * Compare with the baseline
+    // *
+    if (world_rank == 0)
+    {
+      const std::map<std::string, double> baseline = readBaseline(argv[2]);
+      std::size_t numSlower = 0;
+
+      std::cout << "\n" << data.numActualExprs << " expressions, " << data.numCase << " cases, "
+                << data.numCtrl << " controls, " << data.numStates << " states, pattern size "
+                << data.setSize << ", " << world_size << " processes\n"
+                << "Peak memory per process: " << maxLoadMemory << " MB after loading, "
+                << maxMemory << " MB at the end\n\n"
+                << std::left << std::setw(18) << "benchmark" << std::right
+                << std::setw(14) << "seconds" << std::setw(24) << "throughput"
+                << std::setw(14) << "baseline" << std::setw(10) << "change" << "\n";
+
+      for (auto it = std::begin(results); it != std::end(results); ++it)
+      {
+        std::ostringstream throughput;
+        throughput.precision(4);
+        throughput << it->items / it->seconds << " " << it->unit << "/s";
+
+        std::cout << std::left << std::setw(18) << it->name << std::right << std::setprecision(4)
+                  << std::setw(14) << it->seconds << std::setw(24) << throughput.str();
+
+        const auto base = baseline.find(it->name);
+        if (base != baseline.end() && base->second > 0)
+        {
+          const double change = it->seconds / base->second - 1;
+          std::ostringstream percent;
+          percent << std::showpos << std::fixed << std::setprecision(1) << 100 * change << "%";
+          std::cout << std::setw(14) << base->second << std::setw(10) << percent.str();
+          if (change > tolerance)
+          {
+            std::cout << "  SLOWER";
+            ++numSlower;
+          }
+        }
+        std::cout << "\n";
+      }
+      std::cout << std::endl;
+
+      if (argc == 4)
+      {
+        writeBaseline(argv[2], results, data);
+        std::cout << "Wrote the baseline " << argv[2] << std::endl;
+      }
+      else if (numSlower > 0)
+      {
+        std::cout << numSlower << " benchmarks are more than " << 100 * tolerance
+                  << "% slower than the baseline" << std::endl;
+        exitCode = 2;
+      }
+    }
+  }
+  catch (std::exception &e)
+  {
+    std::cout << "  *** Fatal error reported by rank_"
+              << world_rank << ": " << e.what() << " ***" << std::endl;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  MPI_Finalize();
+  return exitCode;
+}
@@ -0,0 +1,39 @@
+#include <iostream>
+
+#include "CSFS_Data.h"
+
+// *
+// * csfs-convert reads the DATA_FILE named in a config file, bins it as the
+// * config file describes, and writes the result in the binary format that
+// * csfs reads much faster. Point DATA_FILE at the binary file in later runs
+// * that use the same binning; PATTERN_SIZE, the bounds, and the thresholds
+// * can still change.
+// *
+int main(int argc, char **argv)
+{
+  if (argc != 3)
+  {
+    std::cerr << "Usage:\n   " << argv[0] << " <config file> <output file>" << std::endl;
+    return 1;
+  }
+
+  try
+  {
+    const CSFS_Data data(argv[1]);
+    data.checkParameters();
+    data.writeBinary(argv[2]);
+
+    std::cout << "Wrote " << data.numActualExprs << " expressions, " << data.numStates
+              << " states and " << data.numIndiv << " individuals ("
+              << data.numCase << " cases, " << data.numCtrl << " controls) from "
+              << data.inputFilename << " to " << argv[2] << " in "
+              << data.elapsed_wall_time() << " seconds." << std::endl;
+  }
+  catch (std::exception &e)
+  {
+    std::cerr << "  *** Fatal error: " << e.what() << " ***" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include "CSFS_Data.h"
+
+// *
+// * csfs-generate writes a synthetic cohort for benchmarking: a data file of
+// * random HIGH/LOW (and NORM) values with missing values, a config file that
+// * runs csfs on it, and the patterns planted in it. Each planted pattern is
+// * carried by about PLANTED_CASE_RATE of the cases and PLANTED_CTRL_RATE of
+// * the controls, so its objective value is known ahead of time. The same
+// * generator config and SEED always give the same cohort.
+// *
+namespace
+{
+  struct Planted
+  {
+    std::vector<std::size_t> exprs;
+    std::vector<std::size_t> bins; // index into the bins in use
+  };
+
+
+  //----------------------------------------------------------------------------
+  // Writes a config file for csfs that reads the given data file. Settings
+  // for csfs-bench are copied from the generator config.
+  //----------------------------------------------------------------------------
+  void writeRunConfig(const ConfigParser &gen, const std::string &filename, const std::string &dataFile)
+  {
+    std::ofstream cfg(filename.c_str());
+    if (!cfg.is_open())
+      throw std::runtime_error("Could not open " + filename + " for writing.");
+
+    const bool useNorm = gen.getSizeT("NUM_BINS") == 3;
+
+    cfg << "# Written by csfs-generate\n"
+        << "DATA_FILE  " << dataFile << "\n"
+        << "RISK  true\n"
+        << "NUM_CASES  " << gen.getSizeT("NUM_CASES") << "\n"
+        << "NUM_CTRLS  " << gen.getSizeT("NUM_CTRLS") << "\n"
+        << "NUM_EXPRS  " << gen.getSizeT("NUM_EXPRS") << "\n"
+        << "NUM_HEAD_ROWS  1\n"
+        << "NUM_HEAD_COLS  1\n"
+        << "PATTERN_SIZE  " << gen.getSizeT("PATTERN_SIZE") << "\n"
+        << "USE_LOWER_CUTOFF  false\n"
+        << "USE_SOLUTION_POOL_THRESHOLD  false\n"
+        << "SOLUTION_POOL_THRESHOLD  0\n"
+        << "STARTING_LOWER_BOUND  0\n"
+        << "STARTING_UPPER_BOUND  1\n"
+        << "QUIET  true\n"
+        << "VERBOSE  false\n"
+        << "PRINT_CPLEX_OUTPUT  false\n"
+        << "TOL  0.000001\n"
+        << "ID_PREFIX  g\n"
+        << "MISSING_SYMBOL  NA\n"
+        << "CPLEX_SEED  " << gen.getSizeT("SEED") << "\n"
+        << "USE_SPARSE_CONTRAINTS  true\n"
+        << "NUM_BINS  " << (useNorm ? 3 : 2) << "\n"
+        << "USE_HIGH  true\n"
+        << "USE_NORM  " << (useNorm ? "true" : "false") << "\n"
+        << "USE_LOW  true\n"
+        << "USE_NOT_HIGH  false\n"
+        << "USE_NOT_LOW  false\n"
+        << "HIGH_VALUE  1\n"
+        << "NORM_VALUE  0\n"
+        << "LOW_VALUE  -1\n"
+        << "NOT_LOW_VALUE  0\n"
+        << "NOT_HIGH_VALUE  0\n"
+        << "SET_NA_TRUE  true\n";
+
+    const char *copied[] = {"SPARSE_SOLVER", "WORKER_THREADS", "BENCH_CUTS", "BENCH_CUT_SIZE",
+                            "BENCH_RELAXATIONS", "BENCH_SPARSE_PROBLEMS", "BENCH_ROUND_TRIPS",
+                            "BENCH_TOLERANCE"};
+    for (std::size_t k = 0; k < sizeof(copied) / sizeof(copied[0]); ++k)
+    {
+      if (gen.contains(copied[k]))
+        cfg << copied[k] << "  " << gen.getString(copied[k]) << "\n";
+    }
+
+    if (!cfg)
+      throw std::runtime_error("Could not write " + filename + ".");
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  if (argc != 3)
+  {
+    std::cerr << "Usage:\n   " << argv[0] << " <generator config file> <output prefix>" << std::endl;
+    return 1;
+  }
+
+  try
+  {
+    const ConfigParser gen(argv[1]);
+    const std::string prefix = argv[2];
+
+    const std::size_t numExprs = gen.getSizeT("NUM_EXPRS");
+    const std::size_t numCase = gen.getSizeT("NUM_CASES");
+    const std::size_t numCtrl = gen.getSizeT("NUM_CTRLS");
+    const std::size_t numBins = gen.getSizeT("NUM_BINS");
+    const std::size_t setSize = gen.getSizeT("PATTERN_SIZE");
+    const double naRate = gen.getDouble("NA_RATE");
+    const std::size_t numPlanted = gen.getSizeT("NUM_PLANTED");
+    const double caseRate = gen.getDouble("PLANTED_CASE_RATE");
+    const double ctrlRate = gen.getDouble("PLANTED_CTRL_RATE");
+    const bool binary = gen.contains("FORMAT") && gen.getString("FORMAT") == "BINARY";
+
+    if (numBins != 2 && numBins != 3)
+      throw std::runtime_error("NUM_BINS must be 2 (HIGH, LOW) or 3 (HIGH, NORM, LOW).");
+    if (numExprs == 0 || numCase == 0 || numCtrl == 0 || setSize == 0)
+      throw std::runtime_error("NUM_EXPRS, NUM_CASES, NUM_CTRLS and PATTERN_SIZE must be positive.");
+    if (numPlanted * setSize > numExprs)
+      throw std::runtime_error("NUM_PLANTED * PATTERN_SIZE must not be more than NUM_EXPRS.");
+    if (naRate < 0 || naRate >= 1 || caseRate < 0 || caseRate > 1 || ctrlRate < 0 || ctrlRate > 1)
+      throw std::runtime_error("NA_RATE, PLANTED_CASE_RATE and PLANTED_CTRL_RATE must be between 0 and 1.");
+
+    const std::vector<const char *> binNames = numBins == 3 ? std::vector<const char *>{"HIGH", "NORM", "LOW"}
+                                                            : std::vector<const char *>{"HIGH", "LOW"};
+    const std::vector<const char *> binValues = numBins == 3 ? std::vector<const char *>{"1", "0", "-1"}
+                                                             : std::vector<const char *>{"1", "-1"};
+    const std::size_t numIndiv = numCase + numCtrl;
+    std::mt19937_64 rng(gen.getSizeT("SEED"));
+
+    // *
+    // * Plant the patterns on distinct expressions, and pick the individuals
+    // * carrying each one
+    // *
+    std::vector<Planted> planted(numPlanted);
+    std::vector<unsigned char> value(numExprs * numIndiv); // bin index, or numBins for NA
+    {
+      std::vector<std::size_t> order(numExprs);
+      for (std::size_t i = 0; i < numExprs; ++i)
+        order[i] = i;
+      std::shuffle(std::begin(order), std::end(order), rng);
+
+      for (std::size_t p = 0; p < numPlanted; ++p)
+      {
+        for (std::size_t k = 0; k < setSize; ++k)
+        {
+          planted[p].exprs.push_back(order[p * setSize + k]);
+          planted[p].bins.push_back(rng() % numBins);
+        }
+      }
+    }
+
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for (std::size_t i = 0; i < numExprs; ++i)
+    {
+      for (std::size_t j = 0; j < numIndiv; ++j)
+        value[i * numIndiv + j] = uniform(rng) < naRate ? numBins : rng() % numBins;
+    }
+
+    for (auto p = std::begin(planted); p != std::end(planted); ++p)
+    {
+      for (std::size_t j = 0; j < numIndiv; ++j)
+      {
+        if (uniform(rng) < (j < numCase ? caseRate : ctrlRate))
+        {
+          for (std::size_t k = 0; k < setSize; ++k)
+            value[p->exprs[k] * numIndiv + j] = p->bins[k];
+        }
+      }
+    }
+
+    // *
+    // * Write the data file: one header row, one header column
+    // *
+    const std::string dataFile = prefix + ".tsv";
+    {
+      std::ofstream output(dataFile.c_str());
+      if (!output.is_open())
+        throw std::runtime_error("Could not open " + dataFile + " for writing.");
+
+      output << "ID";
+      for (std::size_t j = 0; j < numCase; ++j)
+        output << "\tcase_" << j;
+      for (std::size_t j = 0; j < numCtrl; ++j)
+        output << "\tctrl_" << j;
+      output << "\n";
+
+      std::string row;
+      for (std::size_t i = 0; i < numExprs; ++i)
+      {
+        row = "g" + std::to_string(i);
+        for (std::size_t j = 0; j < numIndiv; ++j)
+        {
+          row += '\t';
+          const unsigned char v = value[i * numIndiv + j];
+          row += v == numBins ? "NA" : binValues[v];
+        }
+        row += '\n';
+        output << row;
+      }
+
+      if (!output)
+        throw std::runtime_error("Could not write " + dataFile + ".");
+    }
+
+    const std::string configFile = prefix + ".cfg";
+    writeRunConfig(gen, configFile, dataFile);
+
+    // *
+    // * Read the cohort back as csfs will, convert it if asked, and write the
+    // * planted patterns with their states and objective values
+    // *
+    const CSFS_Data data(configFile);
+    data.checkParameters();
+
+    if (binary)
+    {
+      data.writeBinary(prefix + ".bin");
+      writeRunConfig(gen, configFile, prefix + ".bin");
+    }
+
+    const std::string plantedFile = prefix + ".planted";
+    std::ofstream output(plantedFile.c_str());
+    if (!output.is_open())
+      throw std::runtime_error("Could not open " + plantedFile + " for writing.");
+
+    const std::vector<std::size_t> binIndex = numBins == 3 ? std::vector<std::size_t>{data.getHighIndex(), data.getNormIndex(), data.getLowIndex()}
+                                                           : std::vector<std::size_t>{data.getHighIndex(), data.getLowIndex()};
+
+    output << "# Planted patterns: states, cases and controls carrying the pattern, objective value\n";
+    for (auto p = std::begin(planted); p != std::end(planted); ++p)
+    {
+      std::vector<std::size_t> states;
+      for (std::size_t k = 0; k < setSize; ++k)
+      {
+        states.push_back(p->exprs[k] * numBins + binIndex[p->bins[k]]);
+        output << (k ? " " : "") << "g" << p->exprs[k] << "_" << binNames[p->bins[k]];
+      }
+
+      const std::size_t cases = data.exprs.countCarryingAll(states, data.grpOneStart, data.grpOneEnd);
+      const std::size_t ctrls = data.exprs.countCarryingAll(states, data.grpTwoStart, data.grpTwoEnd);
+      output << "\t" << cases << "\t" << ctrls << "\t"
+             << static_cast<double>(cases) / numCase - static_cast<double>(ctrls) / numCtrl << "\n";
+    }
+
+    std::cout << "Wrote " << numExprs << " expressions, " << numCase << " cases and " << numCtrl
+              << " controls with " << numPlanted << " planted patterns to "
+              << (binary ? prefix + ".bin" : dataFile) << ", " << configFile << " and "
+              << plantedFile << " in " << data.elapsed_wall_time() << " seconds." << std::endl;
+  }
+  catch (std::exception &e)
+  {
+    std::cerr << "  *** Fatal error: " << e.what() << " ***" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -2,9 +2,11 @@
 
 int main(int argc, char **argv) {
   //*
-  //* MPI init
+  //* MPI init. Only the main thread of each rank makes MPI calls; worker ranks
+  //* solve sparse problems on additional threads (WORKER_THREADS).
   //*
-  MPI_Init(NULL, NULL);  
+  int provided;
+  MPI_Init_thread(NULL, NULL, MPI_THREAD_FUNNELED, &provided);
 
   const int world_rank = Parallel::getWorldRank();
   const int world_size = Parallel::getWorldSize();
@@ -15,10 +17,12 @@ int main(int argc, char **argv) {
     // *
     if (world_rank == 0) {
       std::ostringstream oss;
-      if (argc != 2)
-        oss << "Usage:\n   " << argv[0] << " <config file>";
+      if (argc != 2 && !(argc == 4 && std::string(argv[2]) == "--resume"))
+        oss << "Usage:\n   " << argv[0] << " <config file> [--resume <checkpoint file>]";
       else if (world_size < 2)
         oss << "world_size must be greater than 1.";
+      else if (provided < MPI_THREAD_FUNNELED)
+        oss << "The MPI library does not support MPI_THREAD_FUNNELED, which the worker threads need.";
 
       if ( !oss.str().empty() ) // exit if an above condition was met
       {
@@ -31,11 +35,103 @@ int main(int argc, char **argv) {
     // *
     // * Set up the data
     // *
-    const CSFS_Data data(argv[1]);
+    std::unique_ptr<const CSFS_Data> fullData(new CSFS_Data(argv[1]));
     if (world_rank == 0)
     {
-      data.checkParameters();
-      printInitialMessages(data);
+      fullData->checkParameters();
+      printInitialMessages(*fullData);
+    }
+
+
+    // *
+    // * Best pattern of an earlier run, read on rank 0 (with the data file's
+    // * states, before the presolve) and sent to every rank
+    // *
+    std::vector<std::size_t> knownPattern;
+    if (!fullData->inputPatfileName.empty())
+    {
+      MessageBuffer buffer;
+      if (world_rank == 0)
+        buffer.putIndexSet(CSFS::getBestPatternInPatfile(fullData.get()), fullData->numStates);
+      buffer.broadcast(0);
+      knownPattern = buffer.getIndexSet(fullData->numStates);
+    }
+
+    double knownObjValue = fullData->STARTING_LOWER_BOUND;
+    if (!knownPattern.empty())
+      knownObjValue = CSFS::getObjectiveValue(fullData->exprs.countCarryingAll(knownPattern, fullData->grpOneStart, fullData->grpOneEnd),
+                                              fullData->exprs.countCarryingAll(knownPattern, fullData->grpTwoStart, fullData->grpTwoEnd),
+                                              fullData.get());
+
+
+    // *
+    // * Heuristic, with its starts shared out across the ranks. Its pattern is
+    // * used if it is better than the known one.
+    // *
+    if (fullData->HEURISTIC_STARTS > 0 && !fullData->USE_SOLUTION_POOL_THRESHOLD)
+    {
+      Timer heuristicTimer(true);
+      double objValue;
+      const std::vector<std::size_t> pattern = Heuristic::bestPattern(*fullData, &objValue);
+      heuristicTimer.stop();
+
+      const bool better = !pattern.empty() && (knownPattern.empty() || objValue > knownObjValue);
+      if (better)
+      {
+        knownPattern = pattern;
+        knownObjValue = objValue;
+      }
+
+      if (world_rank == 0 && !fullData->QUIET)
+        std::cout << "Heuristic found a pattern with objective value " << objValue << " in "
+                  << heuristicTimer.elapsed_wall_time() << " seconds"
+                  << (better ? "" : " (not used)") << "\n" << std::endl;
+    }
+
+
+    // *
+    // * Presolve. Every rank holds the whole data set, so each one drops the
+    // * same states itself. The known pattern is kept.
+    // *
+    if (fullData->PRESOLVE)
+    {
+      const std::vector<std::size_t> kept = Presolve::keptStates(*fullData, knownPattern, knownObjValue);
+      if (kept.size() < fullData->numStates)
+      {
+        if (world_rank == 0 && !fullData->QUIET)
+          std::cout << "Presolve removed " << fullData->numStates - kept.size() << " of "
+                    << fullData->numStates << " marker states\n" << std::endl;
+        fullData.reset(new CSFS_Data(*fullData, kept));
+      }
+    }
+    const CSFS_Data &data = *fullData;
+
+
+    // *
+    // * Enumeration, in place of cut and solve
+    // *
+    if (data.ENUMERATE)
+    {
+      const std::vector<Solution> solutions = Enumeration::solve(data, knownObjValue);
+
+      if (world_rank == 0)
+      {
+        std::ofstream logfile(data.logfileName.c_str());
+        if (!logfile.is_open())
+          throw std::runtime_error("Logfile could not be opened");
+
+        for (auto it = std::begin(solutions); it != std::end(solutions); ++it)
+          CSFS::printSolution(*it, &logfile, &data);
+
+        std::cout << "\nDone.\n"
+                  << "\nPatterns found: " << solutions.size()
+                  << "\n\nTotal execution time"
+                  << "\nCPU seconds: " << data.elapsed_cpu_time()
+                  << "\nWall clock seconds: " << data.elapsed_wall_time() << std::endl;
+      }
+
+      MPI_Finalize();
+      return 0;
     }
 
 
@@ -48,6 +144,10 @@ int main(int argc, char **argv) {
       case 0:
       {
         CutAndSolveController controller(data);
+        if (!knownPattern.empty() || !data.inputCutfileName.empty())
+          controller.warmStart(knownPattern);
+        if (argc == 4)
+          controller.resume(argv[3]);
 
         while ( !controller.converged() )
           controller.work();
@@ -57,12 +157,15 @@ int main(int argc, char **argv) {
         while ( controller.workersStillWorking() )
           controller.waitForWorkers();
 
+        controller.recordSummary();
+
         std::cout << "\nDone.\n"
                   << "\nUpper bound: " << controller.getUb()
                   << "\nLower bound: " << controller.getLb()
                   << "\n\nTotal execution time"
                   << "\nCPU seconds: " << data.elapsed_cpu_time()
-                  << "\nWall clock seconds: " << data.elapsed_wall_time() << std::endl;
+                  << "\nWall clock seconds: " << data.elapsed_wall_time()
+                  << "\nSparse problem CPU seconds (all workers): " << controller.getTotalSparseTime() << std::endl;
 
         break;
       }
@@ -104,6 +207,16 @@ void printInitialMessages(const CSFS_Data &data)
 
   consoleOutput << "  Solutions will be written to:\n    " << data.logfileName << "\n\n";
 
+  if (data.WRITE_CUTS_FILE)
+    consoleOutput << "  Solved cuts will be written to:\n    " << data.outputCutfileName << "\n\n";
+
+  if (!data.telemetryFileName.empty())
+    consoleOutput << "  Telemetry will be written to:\n    " << data.telemetryFileName << "\n\n";
+
+  if (data.CHECKPOINT_INTERVAL > 0)
+    consoleOutput << "  Checkpoints will be written every " << data.CHECKPOINT_INTERVAL
+                  << " seconds to:\n    " << data.checkpointFileName << "\n\n";
+
   consoleOutput << "  Assumed the first " << data.numHeadCols
                 << " columns are header columns, the next " << data.numCase
                 << " columns\n  represent " << data.numCase
@@ -117,6 +230,9 @@ void printInitialMessages(const CSFS_Data &data)
     const int world_size = Parallel::getWorldSize();
     consoleOutput << "  Running " << world_size << " processes (1 controller and "
                   << world_size - 1 << " workers).\n\n";
+    if (data.WORKER_THREADS > 1)
+      consoleOutput << "  Each worker solves up to " << data.WORKER_THREADS
+                    << " sparse problems at once.\n\n";
   }
 
   if (data.RISK)
@@ -126,6 +242,9 @@ void printInitialMessages(const CSFS_Data &data)
     consoleOutput << "  Protective patterns of size 1 through "
                   << data.setSize << " will be identified.\n\n";
 
+  if (data.ENUMERATE)
+    consoleOutput << "  Every pattern will be scored instead of running cut and solve.\n\n";
+
   if (data.USE_SOLUTION_POOL_THRESHOLD)
     consoleOutput << "  All patterns with objective value >= " << data.SOLUTION_POOL_THRESHOLD << " will be saved.\n\n";
 
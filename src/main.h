@@ -1,8 +1,12 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+#include <memory>
 #include "CutAndSolveController.h"
 #include "CutAndSolveWorker.h"
+#include "Enumeration.h"
+#include "Heuristic.h"
+#include "Presolve.h"
 
 void printInitialMessages(const CSFS_Data &);
 